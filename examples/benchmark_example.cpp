@@ -0,0 +1,110 @@
+/**
+ *  @author  Anstro Pleuton (https://github.com/anstropleuton)
+ *  @brief   How to benchmark using Confer.
+ *
+ *  @copyright  Copyright (c) 2024 Anstro Pleuton
+ *
+ *    ____             __
+ *   / ___|___  _ __  / _| ___ _ __
+ *  | |   / _ \| '_ \| |_ / _ \ '__|
+ *  | |__| (_) | | | |  _|  __/ |
+ *   \____\___/|_| |_|_|  \___|_|
+ *
+ *  Confer is a testing framework for Anstro Pleuton's libraries and
+ *  programs.
+ *
+ *  This software is licensed under the terms of MIT License.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  Credits where credit's due:
+ *  - ASCII Art generated using https://www.patorjk.com/software/taag with font
+ *    "Standard".
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "confer.hpp"
+
+/**
+ *  @brief  Benchmark summing a vector.
+ */
+CT_BENCHMARK(benchmark_sum) {
+    // Setup before the loop is not measured
+    std::vector<int> values(4096);
+    std::iota(values.begin(), values.end(), 0);
+
+    // Report throughput
+    state.bytes_per_iteration = values.size() * sizeof(int);
+    state.items_per_iteration = values.size();
+
+    while (state.keep_running())
+    {
+        int sum = std::accumulate(values.begin(), values.end(), 0);
+
+        // Keep the compiler from optimizing away the sum
+        do_not_optimize(sum);
+    }
+}
+
+/**
+ *  @brief  Benchmark sorting a vector.
+ */
+CT_BENCHMARK(benchmark_sort) {
+    std::vector<int> values(1024);
+
+    while (state.keep_running())
+    {
+        std::ranges::generate(values, [&, seed = 1]() mutable {
+            return seed = seed * 1103515245 + 12345;
+        });
+        std::ranges::sort(values);
+
+        // Make sure the sorted values are written to memory
+        clobber_memory();
+    }
+}
+
+// This example is meant to be a kick-starter to start using my library, but
+// they do not teach everything.  Refer to the documentation for more details
+auto main() -> int
+{
+    benchmark_case sum_benchmark_case = {
+        .title         = "Sum a vector",
+        .function_name = "benchmark_sum",
+        .function      = benchmark_sum
+    };
+
+    benchmark_case sort_benchmark_case = {
+        .title         = "Sort a vector",
+        .function_name = "benchmark_sort",
+        .function      = benchmark_sort
+    };
+
+    benchmark_suite suite = {
+        .benchmarks  = { &sum_benchmark_case, &sort_benchmark_case },
+        .target_time = std::chrono::milliseconds(500)
+    };
+
+    // Mean, median, standard deviation, min and max time per iteration
+    auto results = suite.run();
+    print_benchmark_results(results);
+}
@@ -197,6 +197,21 @@ CT_TESTER_FN(test_custom_errors_class) {
     CT_END; // Must return 4
 }
 
+/**
+ *  @brief  Test container assertions with the custom @c my_error_t class.
+ */
+CT_TESTER_FN(test_custom_errors_container) {
+    CT_BEGIN;
+
+    std::vector<int> value    = { 1, 2, 3, 4, 5 };
+    std::vector<int> expected = { 1, 0, 3, 0, 5 };
+
+    // Each mismatched element counts as an error
+    CT_ASSERT_CTR(value, expected);
+
+    CT_END; // Must return 2
+}
+
 // This example is meant to be a kick-starter to start using my library, but
 // they do not teach everything.  Refer to the documentation for more details
 auto main() -> int try
@@ -207,8 +222,15 @@ auto main() -> int try
         .function      = test_custom_errors_class
     };
 
+    test_case custom_errors_container_test_case = {
+        .title         = "Test container assertions with my_error_t",
+        .function_name = "test_custom_errors_container",
+        .function      = test_custom_errors_container
+    };
+
     test_suite suite = {
-        .tests       = { &custom_errors_class_test_case },
+        .tests       = { &custom_errors_class_test_case,
+                         &custom_errors_container_test_case },
         .pre_run     = default_pre_runner('='),
         .post_run    = default_post_runner('=')
     };
@@ -216,7 +238,7 @@ auto main() -> int try
     auto failed_runs = suite.run();
     print_failed_tests(failed_runs);
 
-    std::println("If it prints \"4 errors\", it is normal");
+    std::println("If it prints \"4 errors\" and \"2 errors\", it is normal");
 
     return sum_failed_tests_errors(failed_runs).has_errors();
 }
@@ -0,0 +1,147 @@
+/**
+ *  @author  Anstro Pleuton (https://github.com/anstropleuton)
+ *  @brief   How to test properties of generated values using Confer.
+ *
+ *  @copyright  Copyright (c) 2024 Anstro Pleuton
+ *
+ *    ____             __
+ *   / ___|___  _ __  / _| ___ _ __
+ *  | |   / _ \| '_ \| |_ / _ \ '__|
+ *  | |__| (_) | | | |  _|  __/ |
+ *   \____\___/|_| |_|_|  \___|_|
+ *
+ *  Confer is a testing framework for Anstro Pleuton's libraries and
+ *  programs.
+ *
+ *  This software is licensed under the terms of MIT License.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  Credits where credit's due:
+ *  - ASCII Art generated using https://www.patorjk.com/software/taag with font
+ *    "Standard".
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "confer.hpp"
+
+// A user type and its generator: generate a value, and list simpler values
+// to try when a value fails
+struct rectangle {
+    int width;
+    int height;
+};
+
+// Counterexamples are logged with std::format when possible
+template<>
+struct std::formatter<rectangle> : std::formatter<std::string> {
+    auto format(const rectangle &value, std::format_context &context) const
+    {
+        return std::formatter<std::string>::format(
+            std::format("{}x{}", value.width, value.height), context);
+    }
+};
+
+struct rectangle_generator {
+    using value_type = rectangle;
+
+    integral_generator<int> side = { 0, 1000 };
+
+    auto generate(random_source &random, std::size_t size) const -> rectangle
+    {
+        return { side.generate(random, size), side.generate(random, size) };
+    }
+
+    auto shrink(const rectangle &value) const
+    {
+        std::vector<rectangle> shrunk = {};
+        for (int width : side.shrink(value.width))
+        {
+            shrunk.push_back({ width, value.height });
+        }
+        for (int height : side.shrink(value.height))
+        {
+            shrunk.push_back({ value.width, height });
+        }
+        return shrunk;
+    }
+};
+
+CT_TEST(test_sort, "Test sort") {
+    CT_BEGIN;
+
+    // A million cases are checked across all cores
+    CT_ASSERT_PROPERTY("sorting twice is sorting once",
+        vector_of(integral_generator<int> {}),
+        [](std::vector<int> values) {
+            std::ranges::sort(values);
+            auto sorted = values;
+            std::ranges::sort(values);
+            return values == sorted;
+        }, { .cases = 1'000'000 });
+
+    CT_END;
+}
+
+CT_TEST(test_string, "Test string") {
+    CT_BEGIN;
+
+    // Tuples pass their elements as separate arguments
+    CT_ASSERT_PROPERTY("concatenation adds lengths",
+        tuple_of(string_of(), string_of()),
+        [](const std::string &left, const std::string &right) {
+            return (left + right).size() == left.size() + right.size();
+        });
+
+    CT_END;
+}
+
+CT_TEST(test_area, "Test area") {
+    CT_BEGIN;
+
+    // This one fails, and is shrunk to a minimal counterexample such as
+    // 1x1000, logged along with the seed to reproduce it through the
+    // CONFER_PROPERTY_SEED environment variable
+    CT_ASSERT_PROPERTY("area is smaller than 1000", rectangle_generator {},
+        [](const rectangle &value) {
+            return value.width * value.height < 1000;
+        });
+
+    CT_END;
+}
+
+// This example is meant to be a kick-starter to start using my library, but
+// they do not teach everything.  Refer to the documentation for more details
+auto main() -> int
+{
+    test_suite suite = {
+        .tests    = registered_tests().tests(),
+        .pre_run  = default_pre_runner('=',  3),
+        .post_run = default_post_runner('=', 3)
+    };
+
+    auto failed_tests = suite.run();
+    print_failed_tests(failed_tests);
+    return sum_failed_tests_errors(failed_tests) != 0;
+}
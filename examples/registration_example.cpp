@@ -0,0 +1,96 @@
+/**
+ *  @author  Anstro Pleuton (https://github.com/anstropleuton)
+ *  @brief   How to register tests and run them by name using Confer.
+ *
+ *  @copyright  Copyright (c) 2024 Anstro Pleuton
+ *
+ *    ____             __
+ *   / ___|___  _ __  / _| ___ _ __
+ *  | |   / _ \| '_ \| |_ / _ \ '__|
+ *  | |__| (_) | | | |  _|  __/ |
+ *   \____\___/|_| |_|_|  \___|_|
+ *
+ *  Confer is a testing framework for Anstro Pleuton's libraries and
+ *  programs.
+ *
+ *  This software is licensed under the terms of MIT License.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  Credits where credit's due:
+ *  - ASCII Art generated using https://www.patorjk.com/software/taag with font
+ *    "Standard".
+ */
+
+#include <print>
+#include <ranges>
+#include <string_view>
+#include <vector>
+
+#include "confer.hpp"
+
+// Tests defined by CT_TEST register themselves, no need to list them
+CT_TEST(test_addition, "Test addition") {
+    CT_BEGIN;
+
+    CT_ASSERT(1 + 1, 2, "One plus one must be two");
+
+    CT_END;
+}
+
+CT_TEST(test_vector, "Test vector") {
+    CT_BEGIN;
+
+    std::vector<int> values   = { 1, 2, 3 };
+    std::vector<int> expected = { 1, 2, 3 };
+    CT_ASSERT_CTR(values, expected);
+
+    CT_END;
+}
+
+// This example is meant to be a kick-starter to start using my library, but
+// they do not teach everything.  Refer to the documentation for more details
+auto main(int argc, char **argv) -> int
+{
+    test_suite suite = {
+        .tests    = registered_tests().tests(),
+        .pre_run  = default_pre_runner('=',  3),
+        .post_run = default_post_runner('=', 3)
+    };
+
+    // Run only the tests named on the command line, such as "test_vector"
+    if (argc > 1)
+    {
+        suite.tests.clear();
+        for (std::string_view name : std::views::counted(argv + 1, argc - 1))
+        {
+            auto test = registered_tests().find(name);
+            if (!test)
+            {
+                std::println("No test named {}", name);
+                return 1;
+            }
+            suite.tests.emplace_back(test);
+        }
+    }
+
+    auto failed_tests = suite.run();
+    print_failed_tests(failed_tests);
+    return sum_failed_tests_errors(failed_tests) != 0;
+}
@@ -41,13 +41,43 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <format>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
 #include <print>
+#include <random>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -111,6 +141,16 @@ CT_ERRORS_TYPE CT_ERRORS(CT_ERRORS_PARAMS); \
 do {} while (false)
 #endif // ifndef CT_BEGIN
 
+#ifndef CT_BEGIN_CONCURRENT
+/**
+ *  @brief  Begin testing with a @c concurrent_errors counter, so that
+ *          assertions can be used from any thread of the test.
+ */
+#define CT_BEGIN_CONCURRENT        \
+concurrent_errors CT_ERRORS = {}; \
+do {} while (false)
+#endif // ifndef CT_BEGIN_CONCURRENT
+
 #ifndef CT_END
 /**
  *  @brief  End testing.  Write this just before ending the function.
@@ -126,18 +166,119 @@ do {} while (false)
 auto name() -> CT_ERRORS_TYPE
 #endif // ifndef CT_TESTER_FN
 
+#ifndef CT_TEST
+/**
+ *  @brief  Define a tester function and register it in @c test_registry
+ *          with the title.
+ */
+#define CT_TEST(name, title)                                            \
+CT_TESTER_FN(name);                                                     \
+static const test_registration ct_registration_##name(                  \
+    static_test_case { title, #name, name });                           \
+CT_TESTER_FN(name)
+#endif // ifndef CT_TEST
+
+#ifndef CT_TEST_TAGGED
+/**
+ *  @brief  Define a tester function and register it in @c test_registry
+ *          with the title and tags.
+ */
+#define CT_TEST_TAGGED(name, title, ...)                                 \
+CT_TESTER_FN(name);                                                     \
+static constexpr std::string_view ct_tags_##name[] = { __VA_ARGS__ };   \
+static const test_registration ct_registration_##name(                  \
+    static_test_case { title, #name, name, {}, ct_tags_##name });       \
+CT_TESTER_FN(name)
+#endif // ifndef CT_TEST_TAGGED
+
+#ifndef CT_CO_END
+/**
+ *  @brief  End testing in an async tester function.  Assertions that end
+ *          the function use @c CT_END , so they cannot be used there.
+ */
+#define CT_CO_END co_return CT_ERRORS; do {} while (false)
+#endif // ifndef CT_CO_END
+
+#ifndef CT_ASYNC_TESTER_FN
+/**
+ *  @brief  Define an async tester function, a coroutine ending with
+ *          @c CT_CO_END .
+ */
+#define CT_ASYNC_TESTER_FN(name) \
+auto name() -> test_task
+#endif // ifndef CT_ASYNC_TESTER_FN
+
+#ifndef CT_ASYNC_TEST
+/**
+ *  @brief  Define an async tester function and register it in
+ *          @c test_registry with the title.
+ */
+#define CT_ASYNC_TEST(name, title)                                      \
+CT_ASYNC_TESTER_FN(name);                                               \
+static const test_registration ct_registration_##name(                  \
+    static_test_case { title, #name, nullptr, {}, {}, name });          \
+CT_ASYNC_TESTER_FN(name)
+#endif // ifndef CT_ASYNC_TEST
+
+#ifndef CT_CHECK_CANCELLED
+/**
+ *  @brief  End testing if the run was stopped, see @c test_suite::stop .
+ *          Write this in long loops to exit early.
+ */
+#define CT_CHECK_CANCELLED                                   \
+if (current_stop_token.stop_requested()) [[unlikely]]       \
+{                                                            \
+    current_test_cancelled = true;                           \
+    CT_END;                                                  \
+}                                                            \
+do {} while (false)
+#endif // ifndef CT_CHECK_CANCELLED
+
+#ifndef CT_CO_CHECK_CANCELLED
+/**
+ *  @brief  End testing in an async tester function if the run was stopped.
+ */
+#define CT_CO_CHECK_CANCELLED                                \
+if (current_stop_token.stop_requested()) [[unlikely]]       \
+{                                                            \
+    co_await async_mark_cancelled();                         \
+    CT_CO_END;                                               \
+}                                                            \
+do {} while (false)
+#endif // ifndef CT_CO_CHECK_CANCELLED
+
+#ifndef CT_COLD
+/**
+ *  @brief  Mark a function as unlikely to be called, to keep it out of line
+ *          and away from the hot code.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define CT_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#define CT_COLD __declspec(noinline)
+#else // if defined(__GNUC__) || defined(__clang__)
+#define CT_COLD
+#endif // if defined(__GNUC__) || defined(__clang__)
+#endif // ifndef CT_COLD
+
 #ifndef CT_ASSERT_CODE_FMT
 /**
  *  @brief  Assert the condition with customized code if asserted and log
  *          message format parameters.
+ *
+ *  @p value and @p expected are evaluated exactly once and bound to
+ *  references @c ct_value and @c ct_expected , which the format parameters
+ *  may use.  The message is logged out of line.
  */
-#define CT_ASSERT_CODE_FMT(value, expected, code, ...) \
-if (value != expected)                                 \
-{                                                      \
-    logln(__VA_ARGS__);                                \
-    CT_INCREMENT_ERRORS(CT_ERRORS);                    \
-    code;                                              \
-}                                                      \
+#define CT_ASSERT_CODE_FMT(value, expected, code, ...)                    \
+if (auto &&ct_value = (value); false) {}                                 \
+else if (auto &&ct_expected = (expected); ct_value != ct_expected)       \
+[[unlikely]]                                                             \
+{                                                                        \
+    log_assertion_failure(__VA_ARGS__);                                  \
+    CT_INCREMENT_ERRORS(CT_ERRORS);                                      \
+    code;                                                                \
+}                                                                        \
 do {} while (false)
 #endif // ifndef CT_ASSERT_CODE_FMT
 
@@ -155,7 +296,7 @@ CT_ASSERT_CODE_FMT(value, expected, {}, __VA_ARGS__)
  */
 #define CT_ASSERT_CODE(value, expected, message, code)                        \
 CT_ASSERT_CODE_FMT(value, expected, code, "{}: {} != {} ({} != {})", message, \
-    #value, #expected, value, expected)
+    #value, #expected, ct_value, ct_expected)
 #endif // ifndef CT_ASSERT_CODE
 
 #ifndef CT_ASSERT
@@ -164,7 +305,7 @@ CT_ASSERT_CODE_FMT(value, expected, code, "{}: {} != {} ({} != {})", message, \
  */
 #define CT_ASSERT(value, expected, message)                                 \
 CT_ASSERT_CODE_FMT(value, expected, {}, "{}: {} != {} ({} != {})", message, \
-    #value, #expected, value, expected)
+    #value, #expected, ct_value, ct_expected)
 #endif // ifndef CT_ASSERT
 
 #ifndef CT_ASSERT_END_FMT
@@ -182,17 +323,34 @@ CT_ASSERT_CODE_FMT(value, expected, CT_END, __VA_ARGS__)
  */
 #define CT_ASSERT_END(value, expected, message)                        \
 CT_ASSERT_CODE_FMT(value, expected, CT_END, "{}: {} != {} ({} != {})", \
-    message, #value, #expected, value, expected)
+    message, #value, #expected, ct_value, ct_expected)
 #endif // ifndef CT_ASSERT_END
 
+#ifndef CT_ASSERT_BOUND_SIZE
+/**
+ *  @brief  Assert the size of containers that are already bound to
+ *          references, logging them as @p value_name and @p expected_name .
+ */
+#define CT_ASSERT_BOUND_SIZE(value, expected, value_name, expected_name) \
+CT_ASSERT_END_FMT(value.size(), expected.size(),                          \
+    "Invalid size: {}.size() != {}.size() ({} != {})",                    \
+    value_name, expected_name, ct_value, ct_expected)
+#endif // ifndef CT_ASSERT_BOUND_SIZE
+
 #ifndef CT_ASSERT_SIZE
 /**
  *  @brief  Assert container size.
+ *
+ *  @p value and @p expected are evaluated exactly once.
  */
-#define CT_ASSERT_SIZE(value, expected)                \
-CT_ASSERT_END_FMT(value.size(), expected.size(),       \
-    "Invalid size: {}.size() != {}.size() ({} != {})", \
-    #value, #expected, value.size(), expected.size())
+#define CT_ASSERT_SIZE(value, expected)                                  \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); true)                      \
+{                                                                        \
+    CT_ASSERT_BOUND_SIZE(ct_value_ctr, ct_expected_ctr, #value,          \
+        #expected);                                                      \
+}                                                                        \
+do {} while (false)
 #endif // ifndef CT_ASSERT_SIZE
 
 #ifndef CT_ASSERT_ELM
@@ -202,30 +360,44 @@ CT_ASSERT_END_FMT(value.size(), expected.size(),       \
 #define CT_ASSERT_ELM(value, expected, i)                                    \
 CT_ASSERT_FMT(value[i], expected[i],                                         \
     "Invalid element: {}[{}] != {}[{}] ({} != {})", #value, i, #expected, i, \
-    value[i], expected[i])
+    ct_value, ct_expected)
 #endif // ifndef CT_ASSERT_ELM
 
 #ifndef CT_ASSERT_CTR
 /**
  *  @brief  Assert the container.
+ *
+ *  @p value and @p expected are evaluated exactly once.
  */
-#define CT_ASSERT_CTR(value, expected)            \
-CT_ASSERT_SIZE(value, expected);                  \
-for (std::size_t i = 0; i < expected.size(); i++) \
-{                                                 \
-    CT_ASSERT_ELM(value, expected, i);            \
-}                                                 \
+#define CT_ASSERT_CTR(value, expected)                                   \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); true)                      \
+{                                                                        \
+    CT_ASSERT_BOUND_SIZE(ct_value_ctr, ct_expected_ctr, #value,          \
+        #expected);                                                      \
+    add_errors(CT_ERRORS, compare_ranges(ct_value_ctr, ct_expected_ctr,  \
+        #value, #expected));                                             \
+}                                                                        \
 do {} while (false)
 #endif // ifndef CT_ASSERT_CTR
 
 #ifndef CT_ASSERT_SUB_SIZE
 /**
  *  @brief  Assert the nested container size.
+ *
+ *  @p value , @p expected and @p i are evaluated exactly once.
  */
-#define CT_ASSERT_SUB_SIZE(value, expected, i)                 \
-CT_ASSERT_END_FMT(value[i].size(), expected[i].size(),         \
-    "Invalid size: {}[{}].size() != {}[{}].size() ({} != {})", \
-    #value, i, #expected, i, value[i].size(), expected[i].size())
+#define CT_ASSERT_SUB_SIZE(value, expected, i)                           \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); false) {}                  \
+else if (std::size_t ct_index = (i); true)                               \
+{                                                                        \
+    CT_ASSERT_END_FMT(ct_value_ctr[ct_index].size(),                     \
+        ct_expected_ctr[ct_index].size(),                                \
+        "Invalid size: {}[{}].size() != {}[{}].size() ({} != {})",       \
+        #value, ct_index, #expected, ct_index, ct_value, ct_expected);   \
+}                                                                        \
+do {} while (false)
 #endif // ifndef CT_ASSERT_SUB_SIZE
 
 #ifndef CT_ASSERT_SUB_ELM
@@ -235,39 +407,168 @@ CT_ASSERT_END_FMT(value[i].size(), expected[i].size(),         \
 #define CT_ASSERT_SUB_ELM(value, expected, i1, i2)                          \
 CT_ASSERT_FMT(value[i1][i2], expected[i1][i2],                              \
     "Invalid element: {}[{}][{}] != {}[{}][{}] ({} != {})", #value, i1, i2, \
-    #expected, i1, i2, value[i1][i2], expected[i2][i2])
+    #expected, i1, i2, ct_value, ct_expected)
 #endif // ifndef CT_ASSERT_SUB_ELM
 
 #ifndef CT_ASSERT_SUB_CTR
 /**
  *  @brief  Assert the nested container.
+ *
+ *  @p value , @p expected and @p i are evaluated exactly once.
  */
-#define CT_ASSERT_SUB_CTR(value, expected, i)        \
-CT_ASSERT_SUB_SIZE(value, expected, i);              \
-for (std::size_t j = 0; j < expected[i].size(); j++) \
-{                                                    \
-    CT_ASSERT_SUB_ELM(value, expected, i, j);        \
-}                                                    \
+#define CT_ASSERT_SUB_CTR(value, expected, i)                            \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); false) {}                  \
+else if (std::size_t ct_index = (i); true)                               \
+{                                                                        \
+    CT_ASSERT_END_FMT(ct_value_ctr[ct_index].size(),                     \
+        ct_expected_ctr[ct_index].size(),                                \
+        "Invalid size: {}[{}].size() != {}[{}].size() ({} != {})",       \
+        #value, ct_index, #expected, ct_index, ct_value, ct_expected);   \
+    add_errors(CT_ERRORS, compare_ranges(ct_value_ctr[ct_index],         \
+        ct_expected_ctr[ct_index], #value, #expected, ct_index));        \
+}                                                                        \
 do {} while (false)
 #endif // ifndef CT_ASSERT_SUB_CTR
 
 #ifndef CT_ASSERT_NEST_CTR
 /**
  *  @brief  Assert both container and nested container.
+ *
+ *  @p value and @p expected are evaluated exactly once.
  */
-#define CT_ASSERT_NEST_CTR(value, expected)       \
-CT_ASSERT_SIZE(value, expected);                  \
-for (std::size_t i = 0; i < expected.size(); i++) \
-{                                                 \
-    CT_ASSERT_SUB_CTR(value, expected, i);        \
-}                                                 \
+#define CT_ASSERT_NEST_CTR(value, expected)                              \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); true)                      \
+{                                                                        \
+    CT_ASSERT_BOUND_SIZE(ct_value_ctr, ct_expected_ctr, #value,          \
+        #expected);                                                      \
+    mismatch_report ct_report = {                                        \
+        .value_name = #value, .expected_name = #expected };              \
+    for (std::size_t i = 0; i < ct_expected_ctr.size(); i++)             \
+    {                                                                    \
+        if (auto ct_value = ct_value_ctr[i].size(); false) {}            \
+        else if (auto ct_expected = ct_expected_ctr[i].size();           \
+                 ct_value != ct_expected) [[unlikely]]                   \
+        {                                                                \
+            add_errors(CT_ERRORS, ct_report.finish());                   \
+            log_assertion_failure("Invalid size: {}[{}].size() != "      \
+                "{}[{}].size() ({} != {})", #value, i, #expected, i,     \
+                ct_value, ct_expected);                                  \
+            CT_INCREMENT_ERRORS(CT_ERRORS);                              \
+            CT_END;                                                      \
+        }                                                                \
+        ct_report.outer = i;                                             \
+        compare_ranges(ct_value_ctr[i], ct_expected_ctr[i], ct_report);  \
+    }                                                                    \
+    add_errors(CT_ERRORS, ct_report.finish());                           \
+}                                                                        \
 do {} while (false)
 #endif // ifndef CT_ASSERT_NEST_CTR
 
+#ifndef CT_ASSERT_APPROX_CTR
+/**
+ *  @brief  Assert the floating-point container is approximately equal, with
+ *          tolerance from @c absolute_tolerance , @c relative_tolerance or
+ *          @c ulp_tolerance .
+ *
+ *  @p value and @p expected are evaluated exactly once.
+ */
+#define CT_ASSERT_APPROX_CTR(value, expected, tolerance)                 \
+if (auto &&ct_value_ctr = (value); false) {}                             \
+else if (auto &&ct_expected_ctr = (expected); true)                      \
+{                                                                        \
+    CT_ASSERT_BOUND_SIZE(ct_value_ctr, ct_expected_ctr, #value,          \
+        #expected);                                                      \
+    add_errors(CT_ERRORS, compare_approx(ct_value_ctr, ct_expected_ctr,  \
+        tolerance, #value, #expected));                                  \
+}                                                                        \
+do {} while (false)
+#endif // ifndef CT_ASSERT_APPROX_CTR
+
+/**
+ *  @brief  Write every pending log message and flush the log streams.
+ *
+ *  Messages from @c log and @c logln are written by a background writer
+ *  thread.  Call this before writing to @c std::cout or @c log_file
+ *  directly, so the output stays in order.  It is called at the end of
+ *  @c test_suite::run , when @c log_file is opened or closed, on
+ *  @c std::terminate and on crash signals.
+ */
+auto log_flush() -> void;
+
+/**
+ *  @brief  Queue formatted text to be written by the background writer to
+ *          @p stream .
+ *
+ *  @param  stream  Stream to write to.
+ *  @param  text    Formatted text.
+ */
+auto log_submit(std::ostream &stream, std::string_view text) -> void;
+
+/**
+ *  @brief  File stream that flushes pending log messages when opened or
+ *          closed.
+ */
+struct log_stream : std::ofstream {
+
+    using std::ofstream::ofstream;
+
+    /**
+     *  @brief   Flush pending logs and open a file.
+     *
+     *  @tparam  Args  Type of arguments.
+     *  @param   args  Arguments to @c std::ofstream::open .
+     */
+    template<typename ... Args>
+    inline auto open(Args &&... args)
+    {
+        log_flush();
+        std::ofstream::open(std::forward<Args>(args)...);
+    }
+
+    /**
+     *  @brief  Flush pending logs and close the file.
+     */
+    inline auto close()
+    {
+        log_flush();
+        std::ofstream::close();
+    }
+};
+
 /**
  *  @brief  Open this file to redirect logging to a file.
  */
-extern std::ofstream log_file;
+extern log_stream log_file;
+
+/**
+ *  @brief  True while the calling thread allocates for Confer itself, such
+ *          as for logging, which the allocation tracker does not count.
+ */
+inline thread_local bool allocations_untracked = false;
+
+/**
+ *  @brief  Stop counting the allocations of the calling thread while alive.
+ */
+struct untracked_allocations {
+
+    /**
+     *  @brief  Whether the allocations were untracked before.
+     */
+    bool previous = std::exchange(allocations_untracked, true);
+
+    /**
+     *  @brief  Count the allocations again, unless they were untracked
+     *          before.
+     */
+    inline ~untracked_allocations() { allocations_untracked = previous; }
+};
+
+/**
+ *  @brief  Per-thread buffer that log messages are formatted into.
+ */
+inline thread_local std::string log_buffer;
 
 /**
  *  @brief   Log to `std::cout` or provided file.
@@ -282,9 +583,15 @@ template<typename ... Args>
     Args &&...                   args
 )
 {
+    // A failed assertion must not fail an allocation assertion after it
+    untracked_allocations untracked = {};
+    log_buffer.clear();
+    std::format_to(std::back_inserter(log_buffer), format,
+        std::forward<Args>(args)...);
+
     // Print to stdout if no file is specified
     std::ostream &stream = log_file.is_open() ? log_file : std::cout;
-    std::print(stream, format, std::forward<Args>(args)...);
+    log_submit(stream, log_buffer);
 }
 
 /**
@@ -300,178 +607,6474 @@ template<typename ... Args>
     Args &&...                   args
 )
 {
+    // A failed assertion must not fail an allocation assertion after it
+    untracked_allocations untracked = {};
+    log_buffer.clear();
+    std::format_to(std::back_inserter(log_buffer), format,
+        std::forward<Args>(args)...);
+    log_buffer.push_back('\n');
+
     // Print to stdout if no file is specified
     std::ostream &stream = log_file.is_open() ? log_file : std::cout;
-    std::println(stream, format, std::forward<Args>(args)...);
+    log_submit(stream, log_buffer);
 }
 
 /**
- *  @brief  Test the function.
+ *  @brief  Log with newline to @c std::cout or provided file, with
+ *          type-erased format arguments.
+ *
+ *  @param  format  Format specifier.
+ *  @param  args    Format arguments.
  */
-struct test_case {
+auto vlogln(std::string_view format, std::format_args args) -> void;
+
+/**
+ *  @brief   Log a failed assertion.
+ *
+ *  Kept out of line and type-erased, so that an assertion costs only a
+ *  comparison and a branch in the test function, and assertions with the
+ *  same argument types share one instantiation.
+ *
+ *  @tparam  Args    Type of arguments.
+ *  @param   format  Format specifier.
+ *  @param   args    Arguments.
+ */
+template<typename ... Args>
+CT_COLD inline auto log_assertion_failure(
+    std::format_string<Args ...> format,
+    Args &&...                   args
+) -> void
+{
+    vlogln(format.get(), std::make_format_args(args...));
+}
+
+struct concurrent_errors;
+
+/**
+ *  @brief   Add a number of errors to an errors counter.
+ *
+ *  Arithmetic counters and @c concurrent_errors add the number at once.  A
+ *  custom counter adds other counters rather than numbers through
+ *  @c CT_ADD_TO_ERRORS , so it is incremented once per error instead.
+ *
+ *  @tparam  errors_type  Errors counter type.
+ *  @param   errors       Errors counter.
+ *  @param   number       Number of errors.
+ */
+template<typename errors_type>
+inline constexpr auto add_errors(
+    errors_type &errors,
+    std::size_t  number
+) -> void
+{
+    if constexpr (std::same_as<errors_type, concurrent_errors>)
+    {
+        errors += number;
+    }
+    else if constexpr (std::is_arithmetic_v<errors_type>)
+    {
+        CT_ADD_TO_ERRORS(errors, (errors_type)number);
+    }
+    else
+    {
+        for (; number != 0; number--)
+        {
+            CT_INCREMENT_ERRORS(errors);
+        }
+    }
+}
+
+/**
+ *  @brief  Maximum number of mismatched ranges reported by a container
+ *          assertion, 0 for no limit.
+ *
+ *  Mismatches past the limit are still counted as errors and included in
+ *  the total.  Set it before running the tests.
+ */
+inline std::size_t mismatch_report_limit = 16;
 
+/**
+ *  @brief  Collect mismatches of a container assertion, collapsing
+ *          consecutive mismatches into ranges.
+ *
+ *  Each range is logged as one line when it ends, up to @c limit ranges.
+ *  @c finish logs the last range and the total, and returns the number of
+ *  mismatched elements.
+ */
+struct mismatch_report {
     /**
-     *  @brief  Test title, useful to identify failed tests.
+     *  @brief  Name of value container.
      */
-    std::string title;
+    std::string_view value_name;
 
     /**
-     *  @brief  Testing function's name.
+     *  @brief  Name of expected container.
      */
-    std::string function_name;
+    std::string_view expected_name;
 
     /**
-     *  @brief  The function to test which returns the number of errors.
+     *  @brief  Maximum number of ranges to log, 0 for no limit.
      */
-    std::function<CT_ERRORS_TYPE()> function;
+    std::size_t limit = mismatch_report_limit;
 
     /**
-     *  @brief   Run the test.
-     *  @return  The number of errors within the test.
+     *  @brief  Index in the outer container, if nested.
      */
-    [[nodiscard]] inline constexpr auto run() const { return function(); }
-};
+    std::optional<std::size_t> outer;
 
-/**
- *  @brief  A category of tests.
- */
-struct test_suite {
+    /**
+     *  @brief  Number of mismatched elements.
+     */
+    std::size_t mismatches = 0;
 
     /**
-     *  @brief  All the tests.
+     *  @brief  Number of mismatched ranges.
      */
-    std::vector<const test_case *> tests;
+    std::size_t ranges = 0;
 
     /**
-     *  @brief  Function to execute before a test.
+     *  @brief  Outer index of the current range.
      */
-    std::function<void (const test_case *)> pre_run;
+    std::optional<std::size_t> range_outer;
 
     /**
-     *  @brief  Function to execute after a test.
+     *  @brief  First index of the current range.
      */
-    std::function<void (const test_case *, CT_ERRORS_TYPE)> post_run;
+    std::size_t range_begin = 0;
 
     /**
-     *  @brief  Function to execute after a failed test. Return true to stop
-     *          further tests.
-     *  @note   Also executes @c post_run
+     *  @brief  One past the last index of the current range, equal to
+     *          @c range_begin when there is no current range.
      */
-    std::function<bool (const test_case *, CT_ERRORS_TYPE)> run_failed;
+    std::size_t range_end = 0;
 
     /**
-     *  @brief   Run all tests.
-     *  @return  The titles and errors count of each failed test.
+     *  @brief  Formatted first mismatch of the current range, empty if the
+     *          range will not be logged.
      */
-    [[nodiscard]] inline constexpr auto run()
+    std::string range_first;
+
+    /**
+     *  @brief  True if the current range will be logged.
+     *
+     *  @return  True if the current range is within the limit.
+     */
+    [[nodiscard]] inline constexpr auto logging() const -> bool
     {
-        std::vector<std::pair<const test_case *,
-            CT_ERRORS_TYPE>> failed_tests = {};
-        for (auto &test : tests)
+        return limit == 0 || ranges <= limit;
+    }
+
+    /**
+     *  @brief  Add a mismatched element.
+     *
+     *  @tparam  value_type     Type of value element.
+     *  @tparam  expected_type  Type of expected element.
+     *  @param   index          Index of the element.
+     *  @param   value          Value element.
+     *  @param   expected       Expected element.
+     */
+    template<typename value_type, typename expected_type>
+    inline auto add(
+        std::size_t          index,
+        const value_type    &value,
+        const expected_type &expected
+    ) -> void
+    {
+        mismatches++;
+
+        if (range_end != range_begin && range_end == index
+         && range_outer == outer) [[likely]]
         {
-            if (pre_run) pre_run(test);
-            CT_ERRORS_TYPE errors   = test->run();
-            bool           end_test = false;
+            range_end++;
+            return;
+        }
+
+        start_range(index);
+        if (logging())
+        {
+            // Must not fail an allocation assertion after this failed one
+            untracked_allocations untracked = {};
+            range_first = std::format("{} != {}", value, expected);
+        }
+    }
+
+    /**
+     *  @brief  Log the current range and start a new one at @p index .
+     *
+     *  @param  index  Index of the first element of the new range.
+     */
+    CT_COLD auto start_range(std::size_t index) -> void;
+
+    /**
+     *  @brief  Log the current range, if any.
+     */
+    CT_COLD auto end_range() -> void;
+
+    /**
+     *  @brief   Log the last range and the total number of mismatches.
+     *
+     *  @return  Number of mismatched elements.
+     */
+    [[nodiscard]] auto finish() -> std::size_t;
+};
 
-            if (CT_HAS_ERRORS(errors))
+/**
+ *  @brief   True if two ranges can be compared by their bytes.
+ *
+ *  Equal bytes imply equal elements for types with unique object
+ *  representations, so equal blocks can be skipped with @c std::memcmp .
+ *  Differing blocks are still compared with @c operator!= .
+ */
+template<typename value_range, typename expected_range>
+concept bytewise_comparable_ranges
+    = std::ranges::contiguous_range<value_range>
+   && std::ranges::contiguous_range<expected_range>
+   && std::same_as<std::ranges::range_value_t<value_range>,
+                   std::ranges::range_value_t<expected_range>>
+   && std::has_unique_object_representations_v<
+          std::ranges::range_value_t<value_range>>;
+
+/**
+ *  @brief   Compare two ranges element by element and add every mismatch to
+ *           @p report .
+ *
+ *  Contiguous ranges of trivially comparable elements are compared in
+ *  blocks with @c std::memcmp , which runs at memory bandwidth, and only
+ *  differing blocks are compared per element.  Other ranges are compared
+ *  with @c operator!= .  Comparison stops at the end of the shorter range.
+ *
+ *  @tparam  value_range     Type of value range.
+ *  @tparam  expected_range  Type of expected range.
+ *  @param   value           Value range.
+ *  @param   expected        Expected range.
+ *  @param   report          Mismatch report.
+ */
+template<std::ranges::input_range value_range,
+         std::ranges::input_range expected_range>
+inline constexpr auto compare_ranges(
+    const value_range    &value,
+    const expected_range &expected,
+    mismatch_report      &report
+) -> void
+{
+    if constexpr (bytewise_comparable_ranges<value_range, expected_range>)
+    {
+        if !consteval
+        {
+            using element_type = std::ranges::range_value_t<value_range>;
+            constexpr auto block_size
+                = std::max(4096uz / sizeof(element_type), 1uz);
+
+            auto value_data    = std::ranges::data(value);
+            auto expected_data = std::ranges::data(expected);
+            auto size          = std::min<std::size_t>(
+                std::ranges::size(value), std::ranges::size(expected));
+
+            for (std::size_t begin = 0; begin < size; begin += block_size)
             {
-                failed_tests.emplace_back(test, errors);
-                if (run_failed && run_failed(test, errors))
+                auto end = std::min(begin + block_size, size);
+
+                if (std::memcmp(value_data + begin, expected_data + begin,
+                        (end - begin) * sizeof(element_type)) == 0)
+                    [[likely]]
+                {
+                    continue;
+                }
+
+                for (std::size_t i = begin; i < end; i++)
                 {
-                    end_test = true;
+                    if (value_data[i] != expected_data[i])
+                    {
+                        report.add(i, value_data[i], expected_data[i]);
+                    }
                 }
             }
 
-            if (post_run) post_run(test, errors);
-            if (end_test) break;
+            return;
         }
-        return failed_tests;
-    };
-};
+    }
+
+    auto value_it    = std::ranges::begin(value);
+    auto expected_it = std::ranges::begin(expected);
+
+    for (std::size_t i = 0; value_it != std::ranges::end(value)
+                         && expected_it != std::ranges::end(expected);
+         ++value_it, ++expected_it, i++)
+    {
+        if (*value_it != *expected_it) [[unlikely]]
+        {
+            report.add(i, *value_it, *expected_it);
+        }
+    }
+}
 
 /**
- *  @brief   Get fancy default pre-run function for decorated title output.
+ *  @brief   Compare two ranges element by element, log the mismatched
+ *           ranges and return the number of mismatches.
  *
- *  @param   decor_char   Decoration character for before and after title.
- *  @param   decor_count  Decoration character count.
- *  @return  A decorator function.
+ *  @tparam  value_range     Type of value range.
+ *  @tparam  expected_range  Type of expected range.
+ *  @param   value           Value range.
+ *  @param   expected        Expected range.
+ *  @param   value_name      Name of value range.
+ *  @param   expected_name   Name of expected range.
+ *  @param   outer           Index in the outer container, if nested.
+ *  @return  Number of mismatched elements.
  */
-[[nodiscard]] inline auto default_pre_runner(
-    char        decor_char,
-    std::size_t decor_count = 1
-)
+template<std::ranges::input_range value_range,
+         std::ranges::input_range expected_range>
+[[nodiscard]] inline auto compare_ranges(
+    const value_range         &value,
+    const expected_range      &expected,
+    std::string_view           value_name,
+    std::string_view           expected_name,
+    std::optional<std::size_t> outer = std::nullopt
+) -> std::size_t
 {
-    std::string decor = std::ranges::views::repeat(decor_char, decor_count)
-                      | std::ranges::to<std::string>();
-    return [=](const test_case *test) {
-        logln("{} {} {}", decor, test->title, decor);
+    mismatch_report report = {
+        .value_name    = value_name,
+        .expected_name = expected_name,
+        .outer         = outer
     };
+    compare_ranges(value, expected, report);
+    return report.finish();
 }
 
 /**
- *  @brief   Get fancy default post-run function for decorated title output.
- *
- *  @param   decor_char   Decoration character for before and after title.
- *  @param   decor_count  Decoration character count.
- *  @return  A decorator function.
+ *  @brief  How an approximate comparison measures the error.
  */
-[[nodiscard]] inline auto default_post_runner(
-    char        decor_char,
-    std::size_t decor_count = 1
-)
-{
-    std::string decor = std::views::repeat(decor_char, decor_count)
-                        | std::ranges::to<std::string>();
-    return [=](const test_case *test, CT_ERRORS_TYPE errors) {
-        logln("{} End of {}, {} errors {}\n", decor, test->title, errors,
-            decor);
-    };
-}
+enum class tolerance_mode {
+    unknown = -1,
+
+    /**
+     *  @brief  Absolute difference, @c |value-expected| .
+     */
+    absolute,
+
+    /**
+     *  @brief  Difference relative to the larger magnitude,
+     *          @c |value-expected|/max(|value|,|expected|) .
+     */
+    relative,
+
+    /**
+     *  @brief  Number of representable values between value and expected.
+     */
+    ulp,
+
+    max
+};
 
 /**
- *  @brief   Terminate further tests after printing failed test title.
- *  @return  A quitter function.
+ *  @brief   Convert tolerance mode to string.
+ *
+ *  @param   mode  Tolerance mode.
+ *  @return  Name of the tolerance mode.
  */
-[[nodiscard]] inline auto default_run_failed_quitter()
+[[nodiscard]] inline constexpr auto to_string(tolerance_mode mode)
 {
-    return [=](const test_case *test, CT_ERRORS_TYPE errors) {
-        logln("{} failed, cannot conduct further tests.", test->title);
-        return true;
-    };
+    using namespace std::string_literals;
+    switch (mode)
+    {
+        case tolerance_mode::unknown: return "unknown"s;
+        case tolerance_mode::absolute: return "absolute"s;
+        case tolerance_mode::relative: return "relative"s;
+        case tolerance_mode::ulp: return "ulp"s;
+        case tolerance_mode::max: return "max"s;
+    }
+    return ""s;
 }
 
 /**
- *  @brief  Print all failed test's title and errors count.
- *  @param  failed_tests  Failed test results.
+ *  @brief  Tolerance of an approximate comparison.
  */
-inline auto print_failed_tests(
-    const std::vector<std::pair<const test_case *,
+struct tolerance {
+    /**
+     *  @brief  How the error is measured.
+     */
+    tolerance_mode mode = tolerance_mode::absolute;
+
+    /**
+     *  @brief  Largest error that is within tolerance.
+     */
+    double value = 0.0;
+};
+
+/**
+ *  @brief   Tolerance of absolute difference.
+ *
+ *  @param   value  Largest absolute difference.
+ *  @return  Tolerance.
+ */
+[[nodiscard]] inline constexpr auto absolute_tolerance(double value)
+{
+    return tolerance { tolerance_mode::absolute, value };
+}
+
+/**
+ *  @brief   Tolerance of relative difference.
+ *
+ *  @param   value  Largest relative difference.
+ *  @return  Tolerance.
+ */
+[[nodiscard]] inline constexpr auto relative_tolerance(double value)
+{
+    return tolerance { tolerance_mode::relative, value };
+}
+
+/**
+ *  @brief   Tolerance of units in the last place.
+ *
+ *  @param   value  Largest distance in representable values.
+ *  @return  Tolerance.
+ */
+[[nodiscard]] inline constexpr auto ulp_tolerance(std::uint64_t value)
+{
+    return tolerance { tolerance_mode::ulp, (double)value };
+}
+
+/**
+ *  @brief   Map a floating-point value to an integer so that the difference
+ *           of two mapped values is their distance in ULP.
+ *
+ *  @tparam  type   Floating-point type.
+ *  @param   value  Value.
+ *  @return  Mapped value.
+ */
+template<std::floating_point type>
+[[nodiscard]] inline constexpr auto ulp_ordered(type value)
+{
+    using int_type = std::conditional_t<sizeof(type) == 4, std::int32_t,
+        std::int64_t>;
+    static_assert(sizeof(int_type) == sizeof(type),
+        "Only IEEE single and double precision is supported");
+
+    auto bits = std::bit_cast<int_type>(value);
+    return bits < 0 ? std::numeric_limits<int_type>::min() - bits : bits;
+}
+
+/**
+ *  @brief   Distance of two floating-point values in ULP.
+ *
+ *  @tparam  type      Floating-point type.
+ *  @param   value     Value.
+ *  @param   expected  Expected value.
+ *  @return  Distance in ULP.
+ */
+template<std::floating_point type>
+[[nodiscard]] inline constexpr auto ulp_distance(type value, type expected)
+{
+    using uint_type = std::conditional_t<sizeof(type) == 4, std::uint32_t,
+        std::uint64_t>;
+
+    auto a = ulp_ordered(value);
+    auto b = ulp_ordered(expected);
+    return a > b ? (uint_type)a - (uint_type)b : (uint_type)b - (uint_type)a;
+}
+
+/**
+ *  @brief   Error of a value with respect to the expected value.
+ *
+ *  @tparam  type       Floating-point type.
+ *  @param   value      Value.
+ *  @param   expected   Expected value.
+ *  @param   mode       Tolerance mode.
+ *  @return  Error, NaN if either value is NaN, infinity in relative mode if
+ *           an infinity is compared with a different value.
+ */
+template<std::floating_point type>
+[[nodiscard]] inline constexpr auto approx_error(
+    type           value,
+    type           expected,
+    tolerance_mode mode
+) -> double
+{
+    if (std::isnan(value) || std::isnan(expected))
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (value == expected)
+    {
+        return 0.0;
+    }
+
+    auto difference = std::abs((double)value - (double)expected);
+    switch (mode)
+    {
+        case tolerance_mode::relative:
+        {
+            auto scale = std::max(std::abs((double)value),
+                std::abs((double)expected));
+            if (std::isinf(scale))
+            {
+                return std::numeric_limits<double>::infinity();
+            }
+            return scale == 0.0 ? 0.0 : difference / scale;
+        }
+        case tolerance_mode::ulp:
+            return (double)ulp_distance(value, expected);
+        default:
+            return difference;
+    }
+}
+
+/**
+ *  @brief   Count elements of a block that are out of tolerance.
+ *
+ *  One loop per mode without branches in its body, combining conditions
+ *  with @c | rather than @c || , so that the compiler vectorizes it.  Equal
+ *  values, including infinities, are within tolerance and NaN is out of
+ *  tolerance.  An infinity compared with a different value is out of
+ *  tolerance, and the check is done in @c double like @c approx_error , so
+ *  that both agree at the limit.
+ *
+ *  @tparam  type       Floating-point type.
+ *  @param   value      Value block.
+ *  @param   expected   Expected block, at least as long as @p value .
+ *  @param   tolerance  Tolerance.
+ *  @return  Number of elements out of tolerance.
+ */
+template<std::floating_point type>
+[[nodiscard]] inline constexpr auto count_out_of_tolerance(
+    std::span<const type> value,
+    std::span<const type> expected,
+    struct tolerance      tolerance
+) -> std::size_t
+{
+    // An infinite operand makes the difference or the scale infinite, which
+    // would let it through an infinite limit, so both must be finite (and
+    // not NaN) unless equal
+    constexpr auto largest = std::numeric_limits<double>::max();
+    auto           count   = 0uz;
+
+    switch (tolerance.mode)
+    {
+        case tolerance_mode::relative:
+        {
+            for (std::size_t i = 0; i < value.size(); i++)
+            {
+                auto a      = (double)value[i];
+                auto b      = (double)expected[i];
+                auto scale  = std::max(std::abs(a), std::abs(b));
+                auto finite = (std::abs(a) <= largest)
+                            & (std::abs(b) <= largest);
+                count += (a != b) & !(finite
+                         & (std::abs(a - b) <= tolerance.value * scale));
+            }
+            break;
+        }
+        case tolerance_mode::ulp:
+        {
+            auto ulp_limit = (std::uint64_t)tolerance.value;
+            for (std::size_t i = 0; i < value.size(); i++)
+            {
+                count += (ulp_distance(value[i], expected[i]) > ulp_limit)
+                       | (value[i] != value[i]) | (expected[i] != expected[i]);
+            }
+            break;
+        }
+        default:
+            for (std::size_t i = 0; i < value.size(); i++)
+            {
+                auto a      = (double)value[i];
+                auto b      = (double)expected[i];
+                auto finite = (std::abs(a) <= largest)
+                            & (std::abs(b) <= largest);
+                count += (a != b) & !(finite
+                         & (std::abs(a - b) <= tolerance.value));
+            }
+            break;
+    }
+
+    return count;
+}
+
+/**
+ *  @brief  Worst mismatch found by an approximate comparison.
+ */
+struct approx_mismatch {
+    /**
+     *  @brief  Number of elements out of tolerance.
+     */
+    std::size_t count = 0;
+
+    /**
+     *  @brief  Number of compared elements.
+     */
+    std::size_t size = 0;
+
+    /**
+     *  @brief  Index of the worst element.
+     */
+    std::size_t index = 0;
+
+    /**
+     *  @brief  Error of the worst element, NaN if it is NaN.
+     */
+    double error = 0.0;
+
+    /**
+     *  @brief  Value of the worst element.
+     */
+    double value = 0.0;
+
+    /**
+     *  @brief  Expected value of the worst element.
+     */
+    double expected = 0.0;
+};
+
+/**
+ *  @brief  Log a failed approximate comparison.
+ *
+ *  @param  value_name     Name of value container.
+ *  @param  expected_name  Name of expected container.
+ *  @param  tolerance      Tolerance.
+ *  @param  mismatch       Worst mismatch.
+ */
+CT_COLD auto log_approx_mismatch(
+    std::string_view       value_name,
+    std::string_view       expected_name,
+    struct tolerance       tolerance,
+    const approx_mismatch &mismatch
+) -> void;
+
+/**
+ *  @brief   Compare two floating-point ranges approximately, log the worst
+ *           error and return the number of elements out of tolerance.
+ *
+ *  Elements are checked in blocks by a vectorized count, and only blocks
+ *  with elements out of tolerance are searched for the worst error, so a
+ *  passing comparison is a single pass over memory.  Comparison stops at
+ *  the end of the shorter range.
+ *
+ *  @tparam  value_range     Type of value range.
+ *  @tparam  expected_range  Type of expected range.
+ *  @param   value           Value range.
+ *  @param   expected        Expected range.
+ *  @param   tolerance       Tolerance.
+ *  @param   value_name      Name of value range.
+ *  @param   expected_name   Name of expected range.
+ *  @return  Number of elements out of tolerance.
+ */
+template<std::ranges::contiguous_range value_range,
+         std::ranges::contiguous_range expected_range>
+    requires std::floating_point<std::ranges::range_value_t<value_range>>
+          && std::same_as<std::ranges::range_value_t<value_range>,
+                          std::ranges::range_value_t<expected_range>>
+[[nodiscard]] inline constexpr auto compare_approx(
+    const value_range    &value,
+    const expected_range &expected,
+    struct tolerance      tolerance,
+    std::string_view      value_name,
+    std::string_view      expected_name
+) -> std::size_t
+{
+    using type = std::ranges::range_value_t<value_range>;
+    constexpr auto block_size = 4096uz / sizeof(type);
+
+    std::span<const type> values(std::ranges::data(value),
+        std::ranges::size(value));
+    std::span<const type> expecteds(std::ranges::data(expected),
+        std::ranges::size(expected));
+    auto size = std::min(values.size(), expecteds.size());
+
+    approx_mismatch mismatch = { .size = size, .error = -1.0 };
+
+    for (std::size_t begin = 0; begin < size; begin += block_size)
+    {
+        auto length = std::min(block_size, size - begin);
+        auto count  = count_out_of_tolerance(values.subspan(begin, length),
+            expecteds.subspan(begin, length), tolerance);
+
+        if (count == 0) [[likely]]
+        {
+            continue;
+        }
+        mismatch.count += count;
+
+        for (std::size_t i = begin; i < begin + length; i++)
+        {
+            auto error = approx_error(values[i], expecteds[i],
+                tolerance.mode);
+
+            // NaN is the worst error, keep the first one
+            auto worse = std::isnan(error) ? !std::isnan(mismatch.error)
+                                           : error > mismatch.error;
+            if (worse)
+            {
+                mismatch.index    = i;
+                mismatch.error    = error;
+                mismatch.value    = values[i];
+                mismatch.expected = expecteds[i];
+            }
+        }
+    }
+
+    if (mismatch.count != 0) [[unlikely]]
+    {
+        log_approx_mismatch(value_name, expected_name, tolerance, mismatch);
+    }
+
+    return mismatch.count;
+}
+
+/**
+ *  @brief  Default size of the inline storage of @c callable , enough for a
+ *          lambda capturing a few strings or pointers.
+ */
+inline constexpr std::size_t callable_capacity = 64;
+
+/**
+ *  @brief  Function wrapper like @c std::function that stores small
+ *          functions inline without allocating.
+ *
+ *  A function that fits in @p capacity bytes and is nothrow move
+ *  constructible is stored inline.  Any other function is allocated on the
+ *  heap and only its pointer is stored, so moving a callable never throws
+ *  and containers of them move rather than copy when they grow.
+ *
+ *  @tparam  signature  Function signature.
+ *  @tparam  capacity   Size of the inline storage.
+ */
+template<typename signature, std::size_t capacity = callable_capacity>
+struct callable;
+
+/**
+ *  @brief  Function wrapper like @c std::function that stores small
+ *          functions inline without allocating.
+ *
+ *  @tparam  result_type  Return type.
+ *  @tparam  arg_types    Parameter types.
+ *  @tparam  capacity     Size of the inline storage.
+ */
+template<typename result_type, typename ... arg_types, std::size_t capacity>
+struct callable<result_type (arg_types ...), capacity> {
+
+    /**
+     *  @brief  Operations on a stored function of a type.
+     */
+    struct operations {
+        result_type (*invoke)(void *, arg_types ...)  = nullptr;
+        void        (*copy)(void *, const void *)     = nullptr;
+        void        (*move)(void *, void *) noexcept  = nullptr;
+        void        (*destroy)(void *) noexcept       = nullptr;
+    };
+
+    /**
+     *  @brief  Operations on a stored function of type @p function_type .
+     */
+    template<typename function_type>
+    static constexpr operations operations_of = {
+        .invoke  = [](void *storage, arg_types ... args) -> result_type {
+            return std::invoke(*static_cast<function_type *>(storage),
+                std::forward<arg_types>(args)...);
+        },
+        .copy    = [](void *destination, const void *source) {
+            ::new (destination) function_type(
+                *static_cast<const function_type *>(source));
+        },
+        .move    = [](void *destination, void *source) noexcept {
+            ::new (destination) function_type(
+                std::move(*static_cast<function_type *>(source)));
+        },
+        .destroy = [](void *storage) noexcept {
+            static_cast<function_type *>(storage)->~function_type();
+        }
+    };
+
+    /**
+     *  @brief  Operations on a function of type @p function_type allocated
+     *          on the heap, with its pointer stored.
+     */
+    template<typename function_type>
+    static constexpr operations heap_operations_of = {
+        .invoke  = [](void *storage, arg_types ... args) -> result_type {
+            return std::invoke(**static_cast<function_type **>(storage),
+                std::forward<arg_types>(args)...);
+        },
+        .copy    = [](void *destination, const void *source) {
+            ::new (destination) function_type *(new function_type(
+                **static_cast<function_type *const *>(source)));
+        },
+        .move    = [](void *destination, void *source) noexcept {
+            ::new (destination) function_type *(
+                std::exchange(*static_cast<function_type **>(source),
+                    nullptr));
+        },
+        .destroy = [](void *storage) noexcept {
+            delete *static_cast<function_type **>(storage);
+        }
+    };
+
+    /**
+     *  @brief  True if a function of type @p function_type is stored inline.
+     */
+    template<typename function_type>
+    static constexpr bool stored_inline =
+        sizeof(function_type) <= capacity
+        && alignof(function_type) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<function_type>;
+
+    /**
+     *  @brief  Storage of the function.
+     */
+    alignas(std::max_align_t) std::byte storage[capacity];
+
+    /**
+     *  @brief  Operations on the stored function, null if empty.
+     */
+    const operations *functions = nullptr;
+
+    /**
+     *  @brief  Construct an empty callable.
+     */
+    inline constexpr callable() noexcept = default;
+
+    /**
+     *  @brief  Construct an empty callable.
+     */
+    inline constexpr callable(std::nullptr_t) noexcept {}
+
+    /**
+     *  @brief   Construct a callable storing @p function .
+     *
+     *  @tparam  function_type  Type of function.
+     *  @param   function       Function to store.
+     */
+    template<typename function_type>
+        requires (!std::same_as<std::decay_t<function_type>, callable>)
+              && std::is_invocable_r_v<result_type,
+                     std::decay_t<function_type> &, arg_types ...>
+    inline callable(function_type &&function)
+    {
+        using stored_type = std::decay_t<function_type>;
+        static_assert(sizeof(stored_type *) <= capacity,
+            "Capacity of callable is too small for a pointer");
+
+        if constexpr (std::is_pointer_v<stored_type>
+                   || std::is_member_pointer_v<stored_type>)
+        {
+            if (function == nullptr) return;
+        }
+
+        if constexpr (stored_inline<stored_type>)
+        {
+            ::new (storage) stored_type(std::forward<function_type>(function));
+            functions = &operations_of<stored_type>;
+        }
+        else
+        {
+            ::new (storage) stored_type *(
+                new stored_type(std::forward<function_type>(function)));
+            functions = &heap_operations_of<stored_type>;
+        }
+    }
+
+    /**
+     *  @brief  Copy the stored function of @p other .
+     */
+    inline callable(const callable &other)
+    {
+        if (other.functions)
+        {
+            other.functions->copy(storage, other.storage);
+            functions = other.functions;
+        }
+    }
+
+    /**
+     *  @brief  Move the stored function of @p other , leaving it empty.
+     */
+    inline callable(callable &&other) noexcept
+    {
+        if (other.functions)
+        {
+            other.functions->move(storage, other.storage);
+            functions = other.functions;
+            other.reset();
+        }
+    }
+
+    /**
+     *  @brief  Copy the stored function of @p other .
+     */
+    inline auto operator=(const callable &other) -> callable &
+    {
+        if (this != &other)
+        {
+            callable copy = other;
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    /**
+     *  @brief  Move the stored function of @p other , leaving it empty.
+     */
+    inline auto operator=(callable &&other) noexcept -> callable &
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.functions)
+            {
+                other.functions->move(storage, other.storage);
+                functions = other.functions;
+                other.reset();
+            }
+        }
+        return *this;
+    }
+
+    /**
+     *  @brief  Destroy the stored function.
+     */
+    inline ~callable() { reset(); }
+
+    /**
+     *  @brief  Destroy the stored function, leaving the callable empty.
+     */
+    inline auto reset() noexcept -> void
+    {
+        if (functions)
+        {
+            functions->destroy(storage);
+            functions = nullptr;
+        }
+    }
+
+    /**
+     *  @brief   Check if a function is stored.
+     *  @return  True if a function is stored.
+     */
+    [[nodiscard]] inline explicit operator bool() const noexcept
+    {
+        return functions != nullptr;
+    }
+
+    /**
+     *  @brief   Call the stored function.
+     *
+     *  @param   args  Arguments.
+     *  @return  Result of the function.
+     */
+    inline auto operator()(arg_types ... args) const -> result_type
+    {
+        if (!functions)
+        {
+            throw std::bad_function_call();
+        }
+        return functions->invoke(const_cast<std::byte *>(storage),
+            std::forward<arg_types>(args)...);
+    }
+};
+
+/**
+ *  @brief  Stop token of the run of the test on the calling thread, set by
+ *          @c test_suite around each test.
+ */
+inline thread_local std::stop_token current_stop_token = {};
+
+/**
+ *  @brief  True once the test on the calling thread returns early because
+ *          its run was stopped, reset by @c test_suite around each test.
+ *
+ *  Set by @c CT_CHECK_CANCELLED and by the property, stress and rows checks
+ *  that stop early.  A test that checks @c current_stop_token itself sets it
+ *  before returning early, otherwise its result counts as complete.  Async
+ *  tests under @c run_mode::async record it in their job instead, through
+ *  @c CT_CO_CHECK_CANCELLED .
+ */
+inline thread_local bool current_test_cancelled = false;
+
+/**
+ *  @brief   Adapt a tester function that takes a @c std::stop_token for
+ *           @c test_case::function .
+ *
+ *  The function sets @c current_test_cancelled if it returns early because
+ *  of the token.
+ *
+ *  @param   function  Tester function.
+ *  @return  Function passing @c current_stop_token to @p function .
+ */
+template<std::invocable<std::stop_token> function_type>
+[[nodiscard]] inline constexpr auto with_stop_token(function_type function)
+{
+    return [function]() mutable -> CT_ERRORS_TYPE {
+        return std::invoke(function, current_stop_token);
+    };
+}
+
+/**
+ *  @brief  Executor of coroutines, resuming them on one or more threads
+ *          until every started job finished.
+ *
+ *  Coroutines suspended by @c async_yield and @c async_sleep_for are
+ *  resumed by the executor they run on.  Code completing asynchronous work
+ *  on other threads resumes a coroutine through @c post .
+ */
+struct async_executor {
+
+    /**
+     *  @brief  Guards the queues and @c pending .
+     */
+    std::mutex mutex;
+
+    /**
+     *  @brief  Wakes the threads waiting for work.
+     */
+    std::condition_variable condition;
+
+    /**
+     *  @brief  Coroutines to resume.
+     */
+    std::deque<std::coroutine_handle<>> ready;
+
+    /**
+     *  @brief  Coroutines to resume at a time, a heap with the earliest
+     *          first.
+     */
+    std::vector<std::pair<std::chrono::steady_clock::time_point,
+        std::coroutine_handle<>>> timers;
+
+    /**
+     *  @brief  Number of jobs that have not finished.
+     */
+    std::size_t pending = 0;
+
+    /**
+     *  @brief  Resume a coroutine on the executor.  Thread-safe.
+     *  @param  handle  Coroutine.
+     */
+    auto post(std::coroutine_handle<> handle) -> void;
+
+    /**
+     *  @brief  Resume a coroutine on the executor at a time.  Thread-safe.
+     *
+     *  @param  time    Time to resume at.
+     *  @param  handle  Coroutine.
+     */
+    auto post_at(
+        std::chrono::steady_clock::time_point time,
+        std::coroutine_handle<>               handle
+    ) -> void;
+
+    /**
+     *  @brief  Count a job as started.
+     */
+    auto job_started() -> void;
+
+    /**
+     *  @brief  Count a job as finished.
+     */
+    auto job_finished() -> void;
+
+    /**
+     *  @brief  Resume coroutines until every job finished.
+     *
+     *  @param  threads  Number of threads, including the calling thread, 0
+     *                   to use hardware concurrency.
+     *  @param  token    Stop token to set as @c current_stop_token on the
+     *                   threads.
+     */
+    auto run(std::size_t threads = 1, std::stop_token token = {}) -> void;
+};
+
+/**
+ *  @brief  Executor running the coroutine on the calling thread, if any.
+ */
+inline thread_local async_executor *current_executor = nullptr;
+
+/**
+ *  @brief  Awaitable resuming the awaiting coroutine at a time on
+ *          @c current_executor .
+ */
+struct async_sleep {
+
+    /**
+     *  @brief  Time to resume at.
+     */
+    std::chrono::steady_clock::time_point until;
+
+    [[nodiscard]] inline auto await_ready() const
+    {
+        return std::chrono::steady_clock::now() >= until;
+    }
+
+    inline auto await_suspend(std::coroutine_handle<> handle) const
+    {
+        if (!current_executor)
+        {
+            throw std::logic_error("Cannot sleep outside an async_executor");
+        }
+        current_executor->post_at(until, handle);
+    }
+
+    inline auto await_resume() const noexcept {}
+};
+
+/**
+ *  @brief   Suspend an async test for a duration without blocking its
+ *           thread.
+ *
+ *  @param   duration  Duration.
+ *  @return  Awaitable.
+ */
+[[nodiscard]] inline auto async_sleep_for(std::chrono::nanoseconds duration)
+{
+    return async_sleep { std::chrono::steady_clock::now() + duration };
+}
+
+/**
+ *  @brief  Awaitable resuming the awaiting coroutine on
+ *          @c current_executor after the coroutines that are ready.
+ */
+struct async_yield {
+    [[nodiscard]] inline auto await_ready() const noexcept { return false; }
+
+    inline auto await_suspend(std::coroutine_handle<> handle) const
+    {
+        if (!current_executor)
+        {
+            throw std::logic_error("Cannot yield outside an async_executor");
+        }
+        current_executor->post(handle);
+    }
+
+    inline auto await_resume() const noexcept {}
+};
+
+/**
+ *  @brief  Coroutine of an async tester function, returning the errors
+ *          count with @c co_return .
+ *
+ *  The coroutine starts when awaited.  Other async functions returning
+ *  @c test_task can be awaited within, yielding their errors count.
+ */
+struct test_task {
+    struct promise_type {
+
+        /**
+         *  @brief  Errors count returned by the coroutine.
+         */
+        CT_ERRORS_TYPE errors = CT_ERRORS_TYPE(CT_ERRORS_PARAMS);
+
+        /**
+         *  @brief  Exception thrown by the coroutine, if any.
+         */
+        std::exception_ptr exception;
+
+        /**
+         *  @brief  Coroutine awaiting this one.
+         */
+        std::coroutine_handle<> continuation;
+
+        /**
+         *  @brief  Where to record that the test returned early because its
+         *          run was stopped, shared with the @c test_task s it awaits,
+         *          or null to use @c current_test_cancelled .
+         *
+         *  Async tests interleave on the threads of an executor, so a flag
+         *  of the thread could be set by another test.
+         */
+        bool *cancelled = nullptr;
+
+        /**
+         *  @brief  Resume the awaiting coroutine when finished.
+         */
+        struct final_awaiter {
+            [[nodiscard]] inline auto await_ready() const noexcept
+            {
+                return false;
+            }
+
+            [[nodiscard]] inline auto await_suspend(
+                std::coroutine_handle<promise_type> handle
+            ) const noexcept -> std::coroutine_handle<>
+            {
+                auto continuation = handle.promise().continuation;
+                if (continuation) return continuation;
+                return std::noop_coroutine();
+            }
+
+            inline auto await_resume() const noexcept {}
+        };
+
+        [[nodiscard]] inline auto get_return_object()
+        {
+            return test_task {
+                std::coroutine_handle<promise_type>::from_promise(*this)
+            };
+        }
+
+        [[nodiscard]] inline auto initial_suspend() const noexcept
+        {
+            return std::suspend_always();
+        }
+
+        [[nodiscard]] inline auto final_suspend() const noexcept
+        {
+            return final_awaiter();
+        }
+
+        inline auto return_value(CT_ERRORS_TYPE value)
+        {
+            errors = std::move(value);
+        }
+
+        inline auto unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    /**
+     *  @brief  The coroutine.
+     */
+    std::coroutine_handle<promise_type> handle;
+
+    inline explicit test_task(std::coroutine_handle<promise_type> handle)
+        : handle(handle) {}
+
+    inline test_task(test_task &&other) noexcept
+        : handle(std::exchange(other.handle, nullptr)) {}
+
+    inline auto operator=(test_task &&other) noexcept -> test_task &
+    {
+        if (this != &other)
+        {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    inline ~test_task()
+    {
+        if (handle) handle.destroy();
+    }
+
+    [[nodiscard]] inline auto await_ready() const noexcept { return false; }
+
+    template<typename awaiting_promise>
+    [[nodiscard]] inline auto await_suspend(
+        std::coroutine_handle<awaiting_promise> awaiting
+    ) const noexcept
+    {
+        if constexpr (std::same_as<awaiting_promise, promise_type>)
+        {
+            handle.promise().cancelled = awaiting.promise().cancelled;
+        }
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    inline auto await_resume() const -> CT_ERRORS_TYPE
+    {
+        if (handle.promise().exception)
+        {
+            std::rethrow_exception(handle.promise().exception);
+        }
+        return handle.promise().errors;
+    }
+};
+
+/**
+ *  @brief  Awaitable recording in the awaiting @c test_task that the test
+ *          returned early because its run was stopped, used by
+ *          @c CT_CO_CHECK_CANCELLED .  It does not suspend.
+ */
+struct async_mark_cancelled {
+    [[nodiscard]] inline auto await_ready() const noexcept { return false; }
+
+    inline auto await_suspend(
+        std::coroutine_handle<test_task::promise_type> handle
+    ) const noexcept
+    {
+        auto cancelled = handle.promise().cancelled;
+        (cancelled ? *cancelled : current_test_cancelled) = true;
+        return false;
+    }
+
+    inline auto await_resume() const noexcept {}
+};
+
+/**
+ *  @brief  Detached coroutine started on an @c async_executor , which
+ *          counts it as pending until it finishes.
+ */
+struct async_job {
+    struct promise_type {
+
+        /**
+         *  @brief  Executor the job runs on.
+         */
+        async_executor *executor = nullptr;
+
+        /**
+         *  @brief  Destroy the job and count it as finished.
+         */
+        struct final_awaiter {
+            [[nodiscard]] inline auto await_ready() const noexcept
+            {
+                return false;
+            }
+
+            inline auto await_suspend(
+                std::coroutine_handle<promise_type> handle
+            ) const noexcept
+            {
+                auto executor = handle.promise().executor;
+                handle.destroy();
+                executor->job_finished();
+            }
+
+            inline auto await_resume() const noexcept {}
+        };
+
+        [[nodiscard]] inline auto get_return_object()
+        {
+            return async_job {
+                std::coroutine_handle<promise_type>::from_promise(*this)
+            };
+        }
+
+        [[nodiscard]] inline auto initial_suspend() const noexcept
+        {
+            return std::suspend_always();
+        }
+
+        [[nodiscard]] inline auto final_suspend() const noexcept
+        {
+            return final_awaiter();
+        }
+
+        inline auto return_void() const noexcept {}
+
+        [[noreturn]] inline auto unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    /**
+     *  @brief  The coroutine, owned by the executor once started.
+     */
+    std::coroutine_handle<promise_type> handle;
+
+    /**
+     *  @brief  Start the job on an executor.
+     *  @param  executor  Executor.
+     */
+    inline auto start(async_executor &executor)
+    {
+        handle.promise().executor = &executor;
+        executor.job_started();
+        executor.post(std::exchange(handle, nullptr));
+    }
+};
+
+/**
+ *  @brief   Await an async test and store its outcome.
+ *
+ *  @param   task       Async test.
+ *  @param   errors     Errors count of the test.
+ *  @param   exception  Exception thrown by the test, if any.
+ *  @return  Job awaiting the test.
+ */
+[[nodiscard]] inline auto await_test(
+    test_task          &task,
+    CT_ERRORS_TYPE     &errors,
+    std::exception_ptr &exception
+) -> async_job
+{
+    try
+    {
+        errors = co_await task;
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+}
+
+/**
+ *  @brief   Run an async test to completion on the calling thread.
+ *
+ *  @param   task  Async test.
+ *  @return  Errors count of the test.
+ */
+[[nodiscard]] inline auto sync_wait(test_task task) -> CT_ERRORS_TYPE
+{
+    async_executor     executor  = {};
+    CT_ERRORS_TYPE     errors    = CT_ERRORS_TYPE(CT_ERRORS_PARAMS);
+    std::exception_ptr exception = nullptr;
+    await_test(task, errors, exception).start(executor);
+    executor.run(1, current_stop_token);
+    if (exception) std::rethrow_exception(exception);
+    return errors;
+}
+
+/**
+ *  @brief  Test the function.
+ */
+struct test_case {
+
+    /**
+     *  @brief  Test title, useful to identify failed tests.
+     */
+    std::string title;
+
+    /**
+     *  @brief  Testing function's name.
+     */
+    std::string function_name;
+
+    /**
+     *  @brief  The function to test which returns the number of errors.
+     */
+    callable<CT_ERRORS_TYPE ()> function;
+
+    /**
+     *  @brief  Time the test may take before it fails, 0 to use
+     *          @c test_suite::default_timeout .
+     *
+     *  A test that times out on a thread is abandoned and keeps running
+     *  until it returns, so the test case and its @c test_suite must
+     *  outlive it, even past the end of @c test_suite::run .
+     */
+    std::chrono::nanoseconds timeout = {};
+
+    /**
+     *  @brief  Tags to select the test by, see @c test_filter .
+     */
+    std::vector<std::string> tags;
+
+    /**
+     *  @brief  The async function to test, used instead of @c function if
+     *          set.
+     */
+    callable<test_task ()> async_function;
+
+    /**
+     *  @brief   Run the test, running an async test to completion.
+     *  @return  The number of errors within the test.
+     */
+    [[nodiscard]] inline auto run() const -> CT_ERRORS_TYPE
+    {
+        if (async_function) return sync_wait(async_function());
+        return function();
+    }
+};
+
+/**
+ *  @brief  How @c test_suite::run executes the tests.
+ */
+enum class run_mode {
+    unknown = -1,
+
+    /**
+     *  @brief  Run tests one after another on the calling thread.
+     */
+    sequential,
+
+    /**
+     *  @brief  Run tests concurrently on a work-stealing thread pool.
+     */
+    parallel,
+
+    /**
+     *  @brief  Run tests in a pool of forked worker processes, so that a
+     *          crashing test does not take down the whole run.
+     */
+    process,
+
+    /**
+     *  @brief  Start every test at once on an @c async_executor , so that
+     *          async tests overlap while they wait.
+     */
+    async,
+
+    max
+};
+
+/**
+ *  @brief   Convert run mode to string.
+ *
+ *  @param   mode  Run mode.
+ *  @return  Name of the run mode.
+ */
+[[nodiscard]] inline constexpr auto to_string(run_mode mode)
+{
+    using namespace std::string_literals;
+    switch (mode)
+    {
+        case run_mode::unknown: return "unknown"s;
+        case run_mode::sequential: return "sequential"s;
+        case run_mode::parallel: return "parallel"s;
+        case run_mode::process: return "process"s;
+        case run_mode::async: return "async"s;
+        case run_mode::max: return "max"s;
+    }
+    return ""s;
+}
+
+/**
+ *  @brief  Run @p task for every index in range [0, @p count) on a
+ *          work-stealing thread pool.
+ *
+ *  Each worker starts with a contiguous block of indices and steals from the
+ *  back of other workers' blocks when its own runs out.  The calling thread
+ *  participates as one of the workers, or watches the workers if there are
+ *  timeouts.  If a task throws, remaining tasks are cancelled and the first
+ *  exception is rethrown after all workers finished.
+ *
+ *  A task is timed from when it calls @c work_started , so that setting up
+ *  the task does not count against its timeout.  A task that exceeds its
+ *  timeout is reported to @p timed_out and its thread is abandoned and
+ *  replaced, so the run continues.  An abandoned thread keeps running until
+ *  the task returns, so a task must call @c work_finished once it is done
+ *  and return immediately without touching anything else if that returns
+ *  false.
+ *
+ *  @param  count      Number of tasks.
+ *  @param  workers    Number of workers, 0 to use hardware concurrency.
+ *  @param  task       Task to run for an index.  Return false to cancel the
+ *                     tasks that have not started yet.
+ *  @param  timeouts   Timeout of each task, 0 for none.  Empty if there are
+ *                     no timeouts, which does not start the watchdog.
+ *  @param  timed_out  Called on the calling thread with the index of a task
+ *                     that timed out.  Return false to cancel the tasks that
+ *                     have not started yet.
+ */
+auto run_work_stealing(
+    std::size_t                                  count,
+    std::size_t                                  workers,
+    const std::function<bool (std::size_t)>     &task,
+    const std::vector<std::chrono::nanoseconds> &timeouts  = {},
+    const std::function<bool (std::size_t)>     &timed_out = {}
+) -> void;
+
+/**
+ *  @brief  Start the timeout of the task of the calling worker.  A task is
+ *          never timed out before it calls this.
+ */
+auto work_started() -> void;
+
+/**
+ *  @brief   Mark the task of the calling worker as finished, so that it is
+ *           no longer timed out.
+ *  @return  False if the task timed out already and its thread was
+ *           abandoned.
+ */
+[[nodiscard]] auto work_finished() -> bool;
+
+/**
+ *  @brief   Check if the calling thread runs tasks of a pool, of
+ *           @c run_work_stealing or in a worker process of
+ *           @c run_process_pool .
+ *  @return  True if the calling thread is a worker.
+ */
+[[nodiscard]] auto on_worker() -> bool;
+
+/**
+ *  @brief   Get the number of workers of a pool started within a test.
+ *
+ *  A test run by a pool or an @c async_executor shares the cores with the
+ *  other tests, so a pool it starts gets one worker by default instead of
+ *  one per core, which would start a thread per core per running test.
+ *
+ *  @param   workers  Requested number of workers, 0 for the default.
+ *  @return  Number of workers, 0 to use hardware concurrency.
+ */
+[[nodiscard]] inline auto nested_workers(std::size_t workers) -> std::size_t
+{
+    if (workers != 0) return workers;
+    return on_worker() || current_executor ? 1 : 0;
+}
+
+/**
+ *  @brief  Outcome of a task run in a worker process.
+ */
+struct process_result {
+
+    /**
+     *  @brief  Bytes returned by the task.
+     */
+    std::string output;
+
+    /**
+     *  @brief  Everything logged while running the task.
+     */
+    std::string log;
+
+    /**
+     *  @brief  Why the task did not complete, empty if it completed.
+     */
+    std::string crash;
+
+    /**
+     *  @brief  True if the task did not complete because it timed out.
+     */
+    bool timed_out = false;
+
+    /**
+     *  @brief  True if the task did not complete because the run was
+     *          cancelled.
+     */
+    bool cancelled = false;
+};
+
+/**
+ *  @brief  Run @p task for every index in range [0, @p count) on a pool of
+ *          forked worker processes.
+ *
+ *  Workers are forked once and receive indices one at a time over a pipe,
+ *  so the cost of a fork is not paid per task.  Logs within a worker are
+ *  captured and sent back as they are logged, and passed along with the
+ *  result, so the logs of a task that crashes or times out are kept.  A
+ *  worker that crashes is replaced and the run continues.  Only available
+ *  on POSIX systems.
+ *
+ *  @param  count     Number of tasks.
+ *  @param  workers   Number of workers, 0 to use hardware concurrency.
+ *  @param  task      Task to run in a worker for an index, returning bytes to
+ *                    send back.
+ *  @param  done      Called in the calling process with the outcome of each
+ *                    task.  Return false to cancel the tasks that have not
+ *                    started yet.
+ *  @param  timeouts  Timeout of each task, 0 for none, or empty for no
+ *                    timeouts.  A worker that exceeds the timeout is killed
+ *                    and replaced.
+ *  @param  deadline  Time to cancel the run at.
+ *  @param  token     Stop token that cancels the run when a stop is
+ *                    requested, from any thread.
+ *
+ *  Once cancelled, by @p done , by @p deadline or by @p token , running
+ *  tasks are killed right away and reported as cancelled.
+ */
+auto run_process_pool(
+    std::size_t                                                 count,
+    std::size_t                                                 workers,
+    const std::function<std::string (std::size_t)>             &task,
+    const std::function<bool (std::size_t, process_result &&)> &done,
+    const std::vector<std::chrono::nanoseconds>                &timeouts = {},
+    std::chrono::steady_clock::time_point                       deadline =
+        std::chrono::steady_clock::time_point::max(),
+    std::stop_token                                             token = {}
+) -> void;
+
+/**
+ *  @brief   Request a stop when a deadline passes.
+ *
+ *  @param   source    Stop source to request the stop of.
+ *  @param   deadline  Time to request the stop at.
+ *  @return  Thread waiting for the deadline, which stops waiting once
+ *           destroyed.
+ */
+[[nodiscard]] auto request_stop_at(
+    std::stop_source                      source,
+    std::chrono::steady_clock::time_point deadline
+) -> std::jthread;
+
+/**
+ *  @brief   Get the CPU time consumed by the calling thread.
+ *  @return  CPU time of the calling thread.
+ */
+[[nodiscard]] auto thread_cpu_time() -> std::chrono::nanoseconds;
+
+/**
+ *  @brief   Convert a duration to fractional milliseconds for printing.
+ *
+ *  @param   duration  Duration.
+ *  @return  Milliseconds.
+ */
+[[nodiscard]] inline constexpr auto to_milliseconds(
+    std::chrono::nanoseconds duration
+)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/**
+ *  @brief  Hardware performance counter values, each empty if the counter
+ *          is unavailable.
+ */
+struct hardware_counters {
+
+    /**
+     *  @brief  CPU cycles.
+     */
+    std::optional<std::uint64_t> cycles;
+
+    /**
+     *  @brief  Retired instructions.
+     */
+    std::optional<std::uint64_t> instructions;
+
+    /**
+     *  @brief  Mispredicted branches.
+     */
+    std::optional<std::uint64_t> branch_misses;
+
+    /**
+     *  @brief  Last level cache misses.
+     */
+    std::optional<std::uint64_t> cache_misses;
+
+    /**
+     *  @brief   Check if any counter has a value.
+     *  @return  True if any counter has a value.
+     */
+    [[nodiscard]] inline constexpr auto any() const
+    {
+        return cycles || instructions || branch_misses || cache_misses;
+    }
+
+    /**
+     *  @brief   Add the values of another measurement.
+     *
+     *  @param   other  Other measurement.
+     *  @return  This.
+     */
+    inline constexpr auto operator+=(const hardware_counters &other)
+        -> hardware_counters &
+    {
+        auto add = [](auto &total, const auto &value) {
+            if (value) total = total.value_or(0) + *value;
+        };
+        add(cycles, other.cycles);
+        add(instructions, other.instructions);
+        add(branch_misses, other.branch_misses);
+        add(cache_misses, other.cache_misses);
+        return *this;
+    }
+};
+
+/**
+ *  @brief  Start counting hardware events of the calling thread.
+ *
+ *  Counters are opened with @c perf_event_open on Linux, once per thread,
+ *  and are unavailable elsewhere, or when @c perf_event_paranoid or the
+ *  hardware does not allow them.
+ */
+auto start_hardware_counters() -> void;
+
+/**
+ *  @brief   Stop counting hardware events of the calling thread.
+ *
+ *  Values are scaled up if the kernel multiplexed the counters.
+ *
+ *  @return  Events since @c start_hardware_counters .
+ */
+[[nodiscard]] auto stop_hardware_counters() -> hardware_counters;
+
+/**
+ *  @brief  Heap allocations made by a thread or within a scope.
+ */
+struct allocation_stats {
+
+    /**
+     *  @brief  Number of allocations.
+     */
+    std::uint64_t allocations = 0;
+
+    /**
+     *  @brief  Number of deallocations.
+     */
+    std::uint64_t deallocations = 0;
+
+    /**
+     *  @brief  Total bytes allocated.
+     */
+    std::uint64_t bytes = 0;
+
+    /**
+     *  @brief  Bytes allocated and not deallocated, negative if more was
+     *          deallocated than allocated.
+     */
+    std::int64_t live_bytes = 0;
+
+    /**
+     *  @brief  Highest @c live_bytes .
+     */
+    std::int64_t peak_bytes = 0;
+};
+
+/**
+ *  @brief  Allocations of the calling thread, counted by the allocation
+ *          tracker.
+ */
+inline thread_local allocation_stats thread_allocations;
+
+/**
+ *  @brief  True if the allocation tracker is installed by
+ *          @c CT_DEFINE_ALLOCATION_TRACKER .
+ */
+inline bool allocation_tracker_installed = false;
+
+/**
+ *  @brief  Alignment of memory from @c operator new without an alignment.
+ */
+inline constexpr std::size_t default_new_alignment
+    = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+/**
+ *  @brief  Bit set in the size stored in front of memory that was allocated
+ *          with @c allocations_untracked set.
+ */
+inline constexpr std::size_t untracked_allocation_bit
+    = std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 1);
+
+/**
+ *  @brief   Allocate memory and count the allocation for the calling thread,
+ *           unless @c allocations_untracked is set.
+ *
+ *  The size is stored in front of the memory, so that deallocation knows
+ *  it without the sized @c operator delete .
+ *
+ *  @param   size       Size in bytes.
+ *  @param   alignment  Alignment.
+ *  @return  The memory, or null if out of memory.
+ */
+[[nodiscard]] inline auto tracked_allocate(
+    std::size_t size,
+    std::size_t alignment
+) noexcept -> void *
+{
+    alignment = std::max(alignment, default_new_alignment);
+    auto total = (size + alignment + alignment - 1) / alignment * alignment;
+
+    void *memory = nullptr;
+    if (alignment == default_new_alignment)
+    {
+        memory = std::malloc(total);
+    }
+    else
+    {
+#ifdef _WIN32
+        memory = _aligned_malloc(total, alignment);
+#else // ifdef _WIN32
+        memory = std::aligned_alloc(alignment, total);
+#endif // ifdef _WIN32
+    }
+    if (!memory) return nullptr;
+
+    // Deallocation counts it only if it was counted here, whichever thread
+    // deallocates it
+    auto header = allocations_untracked ? size | untracked_allocation_bit
+                                        : size;
+    std::memcpy(memory, &header, sizeof(header));
+    if (allocations_untracked)
+    {
+        return static_cast<std::byte *>(memory) + alignment;
+    }
+
+    auto &stats = thread_allocations;
+    stats.allocations++;
+    stats.bytes      += size;
+    stats.live_bytes += (std::int64_t)size;
+    stats.peak_bytes  = std::max(stats.peak_bytes, stats.live_bytes);
+
+    return static_cast<std::byte *>(memory) + alignment;
+}
+
+/**
+ *  @brief  Deallocate memory from @c tracked_allocate and count the
+ *          deallocation for the calling thread.
+ *
+ *  @param  pointer    The memory.
+ *  @param  alignment  Alignment it was allocated with.
+ */
+inline auto tracked_deallocate(void *pointer, std::size_t alignment) noexcept
+{
+    if (!pointer) return;
+
+    alignment = std::max(alignment, default_new_alignment);
+    auto memory = static_cast<std::byte *>(pointer) - alignment;
+
+    std::size_t header = 0;
+    std::memcpy(&header, memory, sizeof(header));
+
+    if (!(header & untracked_allocation_bit))
+    {
+        auto &stats = thread_allocations;
+        stats.deallocations++;
+        stats.live_bytes -= (std::int64_t)header;
+    }
+
+#ifdef _WIN32
+    if (alignment != default_new_alignment)
+    {
+        _aligned_free(memory);
+        return;
+    }
+#endif // ifdef _WIN32
+    std::free(memory);
+}
+
+#ifndef CT_DEFINE_ALLOCATION_TRACKER
+/**
+ *  @brief  Replace the global @c operator new and @c operator delete to
+ *          track allocations.  Write this in one source file of the tester
+ *          program.
+ */
+#define CT_DEFINE_ALLOCATION_TRACKER                                      \
+static const bool ct_allocation_tracker = allocation_tracker_installed    \
+                                        = true;                           \
+auto operator new(std::size_t size) -> void *                             \
+{                                                                         \
+    auto memory = tracked_allocate(size, 0);                              \
+    if (!memory) throw std::bad_alloc();                                  \
+    return memory;                                                        \
+}                                                                         \
+auto operator new[](std::size_t size) -> void *                           \
+{                                                                         \
+    return operator new(size);                                            \
+}                                                                         \
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * \
+{                                                                         \
+    auto memory = tracked_allocate(size, (std::size_t)alignment);         \
+    if (!memory) throw std::bad_alloc();                                  \
+    return memory;                                                        \
+}                                                                         \
+auto operator new[](std::size_t size, std::align_val_t alignment)         \
+    -> void *                                                             \
+{                                                                         \
+    return operator new(size, alignment);                                 \
+}                                                                         \
+auto operator new(std::size_t size, const std::nothrow_t &) noexcept      \
+    -> void *                                                             \
+{                                                                         \
+    return tracked_allocate(size, 0);                                     \
+}                                                                         \
+auto operator new[](std::size_t size, const std::nothrow_t &) noexcept    \
+    -> void *                                                             \
+{                                                                         \
+    return tracked_allocate(size, 0);                                     \
+}                                                                         \
+auto operator new(std::size_t size, std::align_val_t alignment,           \
+    const std::nothrow_t &) noexcept -> void *                            \
+{                                                                         \
+    return tracked_allocate(size, (std::size_t)alignment);                \
+}                                                                         \
+auto operator new[](std::size_t size, std::align_val_t alignment,         \
+    const std::nothrow_t &) noexcept -> void *                            \
+{                                                                         \
+    return tracked_allocate(size, (std::size_t)alignment);                \
+}                                                                         \
+auto operator delete(void *pointer) noexcept -> void                      \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete[](void *pointer) noexcept -> void                    \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete(void *pointer, std::size_t) noexcept -> void         \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete[](void *pointer, std::size_t) noexcept -> void       \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete(void *pointer, std::align_val_t alignment) noexcept  \
+    -> void                                                               \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+auto operator delete[](void *pointer, std::align_val_t alignment)         \
+    noexcept -> void                                                      \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+auto operator delete(void *pointer, std::size_t,                          \
+    std::align_val_t alignment) noexcept -> void                          \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+auto operator delete[](void *pointer, std::size_t,                        \
+    std::align_val_t alignment) noexcept -> void                          \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+auto operator delete(void *pointer, const std::nothrow_t &) noexcept      \
+    -> void                                                               \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete[](void *pointer, const std::nothrow_t &) noexcept    \
+    -> void                                                               \
+{                                                                         \
+    tracked_deallocate(pointer, 0);                                       \
+}                                                                         \
+auto operator delete(void *pointer, std::align_val_t alignment,           \
+    const std::nothrow_t &) noexcept -> void                              \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+auto operator delete[](void *pointer, std::align_val_t alignment,         \
+    const std::nothrow_t &) noexcept -> void                              \
+{                                                                         \
+    tracked_deallocate(pointer, (std::size_t)alignment);                  \
+}                                                                         \
+static_assert(true)
+#endif // ifndef CT_DEFINE_ALLOCATION_TRACKER
+
+/**
+ *  @brief  Measure the allocations of the calling thread from construction.
+ */
+struct allocation_scope {
+
+    /**
+     *  @brief  Allocations of the thread at construction.
+     */
+    allocation_stats start = thread_allocations;
+
+    /**
+     *  @brief  Peak of live bytes of the thread at construction, restored
+     *          when the scope ends so that enclosing scopes keep their peak.
+     */
+    std::int64_t outer_peak = thread_allocations.peak_bytes;
+
+    /**
+     *  @brief  Restore the peak of live bytes of enclosing scopes.
+     */
+    inline ~allocation_scope()
+    {
+        thread_allocations.peak_bytes = std::max(outer_peak,
+            thread_allocations.peak_bytes);
+    }
+
+    /**
+     *  @brief   Get the allocations since construction.
+     *
+     *  @c allocation_stats::peak_bytes is the peak of the bytes allocated
+     *  since construction, if @c restart_peak was called at construction.
+     *
+     *  @return  Allocations since construction.
+     */
+    [[nodiscard]] inline auto stats() const
+    {
+        auto &now = thread_allocations;
+        return allocation_stats {
+            .allocations   = now.allocations - start.allocations,
+            .deallocations = now.deallocations - start.deallocations,
+            .bytes         = now.bytes - start.bytes,
+            .live_bytes    = now.live_bytes - start.live_bytes,
+            .peak_bytes    = now.peak_bytes - start.live_bytes
+        };
+    }
+
+    /**
+     *  @brief  Start tracking the peak of live bytes from now, so that
+     *          @c stats reports the peak within the scope.  The peak before
+     *          is restored when the scope ends, unless exceeded within it.
+     */
+    inline auto restart_peak()
+    {
+        thread_allocations.peak_bytes = thread_allocations.live_bytes;
+    }
+};
+
+#ifndef CT_ALLOCATION_SCOPE
+/**
+ *  @brief  Start measuring allocations of the scope under the name.
+ */
+#define CT_ALLOCATION_SCOPE(name)                                         \
+if (!allocation_tracker_installed)                                        \
+{                                                                         \
+    throw std::logic_error("Allocation tracker is not installed, write "  \
+        "CT_DEFINE_ALLOCATION_TRACKER in a source file");                 \
+}                                                                         \
+allocation_scope name = {};                                               \
+name.restart_peak();                                                      \
+do {} while (false)
+#endif // ifndef CT_ALLOCATION_SCOPE
+
+#ifndef CT_ASSERT_MAX_ALLOCATIONS
+/**
+ *  @brief  Assert the scope allocated at most the number of times.
+ */
+#define CT_ASSERT_MAX_ALLOCATIONS(scope, max_count)                       \
+if (auto ct_value = (scope).stats().allocations;                          \
+    ct_value > (std::uint64_t)(max_count)) [[unlikely]]                   \
+{                                                                         \
+    log_assertion_failure("Too many allocations in {}: {} > {}", #scope,  \
+        ct_value, (std::uint64_t)(max_count));                            \
+    CT_INCREMENT_ERRORS(CT_ERRORS);                                       \
+}                                                                         \
+do {} while (false)
+#endif // ifndef CT_ASSERT_MAX_ALLOCATIONS
+
+#ifndef CT_ASSERT_NO_ALLOCATIONS
+/**
+ *  @brief  Assert the scope did not allocate.
+ */
+#define CT_ASSERT_NO_ALLOCATIONS(scope) CT_ASSERT_MAX_ALLOCATIONS(scope, 0)
+#endif // ifndef CT_ASSERT_NO_ALLOCATIONS
+
+#ifndef CT_ASSERT_MAX_ALLOCATED_BYTES
+/**
+ *  @brief  Assert the scope allocated at most the number of bytes in total.
+ */
+#define CT_ASSERT_MAX_ALLOCATED_BYTES(scope, max_bytes)                   \
+if (auto ct_value = (scope).stats().bytes;                                \
+    ct_value > (std::uint64_t)(max_bytes)) [[unlikely]]                   \
+{                                                                         \
+    log_assertion_failure("Too many bytes allocated in {}: {} > {}",      \
+        #scope, ct_value, (std::uint64_t)(max_bytes));                    \
+    CT_INCREMENT_ERRORS(CT_ERRORS);                                       \
+}                                                                         \
+do {} while (false)
+#endif // ifndef CT_ASSERT_MAX_ALLOCATED_BYTES
+
+/**
+ *  @brief  Result of a test.
+ */
+struct test_result {
+
+    /**
+     *  @brief  The test.
+     */
+    const test_case *test = nullptr;
+
+    /**
+     *  @brief  Errors count of the test.
+     */
+    CT_ERRORS_TYPE errors = CT_ERRORS_TYPE(CT_ERRORS_PARAMS);
+
+    /**
+     *  @brief  Wall-clock time the test took.
+     */
+    std::chrono::nanoseconds wall_time = {};
+
+    /**
+     *  @brief  CPU time the test's thread consumed.
+     */
+    std::chrono::nanoseconds cpu_time = {};
+
+    /**
+     *  @brief  Allocations the test's thread made, counted if the
+     *          allocation tracker is installed.
+     */
+    allocation_stats allocations = {};
+
+    /**
+     *  @brief  Hardware events of the test's thread, counted if
+     *          @c test_suite::use_hardware_counters is set.
+     */
+    hardware_counters counters = {};
+
+    /**
+     *  @brief  True if the test was skipped as it passed in an earlier run,
+     *          see @c test_suite::cache .
+     */
+    bool cached = false;
+
+    /**
+     *  @brief  True if the test returned early because the run was stopped,
+     *          or its worker process was killed for it, see
+     *          @c test_suite::stop and @c current_test_cancelled .
+     */
+    bool cancelled = false;
+
+    /**
+     *  @brief   Get the errors count.
+     *  @return  Errors count of the test.
+     */
+    [[nodiscard]] inline constexpr operator CT_ERRORS_TYPE() const
+    {
+        return errors;
+    }
+};
+
+/**
+ *  @brief  Reporter of test results, called as tests finish.
+ *
+ *  Reporters are called under the same lock as the other hooks, so they
+ *  need not be thread-safe.
+ */
+struct test_reporter {
+
+    /**
+     *  @brief  Function to execute before the tests.
+     */
+    callable<void ()> begin;
+
+    /**
+     *  @brief  Function to execute after each test, after
+     *          @c test_suite::post_run .
+     */
+    callable<void (const test_result &)> report;
+
+    /**
+     *  @brief  Function to execute after the tests.
+     */
+    callable<void ()> end;
+};
+
+/**
+ *  @brief  Report file that buffers writes and writes them out in chunks.
+ */
+struct report_file {
+
+    /**
+     *  @brief  Output file.
+     */
+    std::ofstream stream;
+
+    /**
+     *  @brief  Text not written out yet.
+     */
+    std::string buffer;
+
+    /**
+     *  @brief  Size of buffered text that is written out, 0 to write out
+     *          every write.
+     */
+    std::size_t buffer_size = 64 * 1024;
+
+    /**
+     *  @brief  Write out the buffered text.
+     */
+    ~report_file();
+
+    /**
+     *  @brief  Open the file for writing, truncating it.
+     *
+     *  @param  path  Path to the file.
+     */
+    auto open(const std::string &path) -> void;
+
+    /**
+     *  @brief  Buffer text, and write out the buffer once it is full.
+     *
+     *  @param  text  Text to write.
+     */
+    auto write(std::string_view text) -> void;
+
+    /**
+     *  @brief  Write out the buffered text and flush the file.
+     */
+    auto flush() -> void;
+
+    /**
+     *  @brief  Write out the buffered text and close the file.
+     */
+    auto close() -> void;
+};
+
+/**
+ *  @brief  Syntax of the patterns of @c test_filter .
+ */
+enum class pattern_syntax {
+    unknown = -1,
+
+    /**
+     *  @brief  Whole text matches, @c * matches any text and @c ? matches
+     *          any character.
+     */
+    glob,
+
+    /**
+     *  @brief  ECMAScript regular expression matching any part of the text.
+     */
+    regex,
+
+    max
+};
+
+/**
+ *  @brief   Convert pattern syntax to string.
+ *
+ *  @param   syntax  Pattern syntax.
+ *  @return  Name of the pattern syntax.
+ */
+[[nodiscard]] inline constexpr auto to_string(pattern_syntax syntax)
+{
+    using namespace std::string_literals;
+    switch (syntax)
+    {
+        case pattern_syntax::unknown: return "unknown"s;
+        case pattern_syntax::glob: return "glob"s;
+        case pattern_syntax::regex: return "regex"s;
+        case pattern_syntax::max: return "max"s;
+    }
+    return ""s;
+}
+
+/**
+ *  @brief  Filter of tests by patterns on title and function name, and by
+ *          tags.
+ *
+ *  A test passes if its title or function name matches any @c include
+ *  pattern (or there are none), it has any of @c include_tags (or there are
+ *  none), its title and function name match no @c exclude pattern, and it
+ *  has none of @c exclude_tags .
+ */
+struct test_filter {
+
+    /**
+     *  @brief  Patterns of tests to run.
+     */
+    std::vector<std::string> include;
+
+    /**
+     *  @brief  Patterns of tests not to run.
+     */
+    std::vector<std::string> exclude;
+
+    /**
+     *  @brief  Tags of tests to run.
+     */
+    std::vector<std::string> include_tags;
+
+    /**
+     *  @brief  Tags of tests not to run.
+     */
+    std::vector<std::string> exclude_tags;
+
+    /**
+     *  @brief  Syntax of the patterns.
+     */
+    pattern_syntax syntax = pattern_syntax::glob;
+
+    /**
+     *  @brief   Check if the filter passes every test.
+     *  @return  True if there are no patterns and no tags.
+     */
+    [[nodiscard]] inline constexpr auto empty() const
+    {
+        return include.empty() && exclude.empty() && include_tags.empty()
+            && exclude_tags.empty();
+    }
+};
+
+/**
+ *  @brief  Compiled patterns of a @c test_filter .
+ */
+struct compiled_filter;
+
+/**
+ *  @brief  Compiled @c test_filter .
+ */
+struct test_matcher {
+
+    /**
+     *  @brief  Compiled patterns.
+     */
+    std::shared_ptr<const compiled_filter> compiled;
+
+    /**
+     *  @brief   Check if a test passes the filter.
+     *
+     *  @param   title          Test title.
+     *  @param   function_name  Testing function's name.
+     *  @param   tags           Test tags.
+     *  @return  True if the test passes.
+     */
+    [[nodiscard]] auto matches(
+        std::string_view                title,
+        std::string_view                function_name,
+        const std::vector<std::string> &tags
+    ) const -> bool;
+};
+
+/**
+ *  @brief   Compile the patterns of a filter.
+ *
+ *  @param   filter  Filter.
+ *  @return  Compiled filter.
+ *  @throws  std::invalid_argument  If a regular expression is invalid.
+ */
+[[nodiscard]] auto compile_filter(const test_filter &filter) -> test_matcher;
+
+/**
+ *  @brief   Get the one-sided p-value of the Mann-Whitney U test that
+ *           @p current is stochastically greater than @p baseline .
+ *
+ *  Exact for small samples without ties, otherwise from the normal
+ *  approximation with tie and continuity correction.
+ *
+ *  @param   current   Current samples.
+ *  @param   baseline  Baseline samples.
+ *  @return  The p-value, 1 if either is empty.
+ */
+[[nodiscard]] auto mann_whitney_p_value(
+    std::span<const double> current,
+    std::span<const double> baseline
+) -> double;
+
+/**
+ *  @brief   Get the median of samples.
+ *
+ *  @param   samples  Samples.
+ *  @return  The median, 0 if empty.
+ */
+[[nodiscard]] auto median_of(std::span<const double> samples) -> double;
+
+/**
+ *  @brief  Measurements of earlier runs by function name, stored in a text
+ *          file with one line of samples per name.
+ *
+ *  Each line holds the function name, with backslashes, tabs and line
+ *  breaks escaped, a tab and the samples separated by spaces.
+ */
+struct performance_baseline {
+
+    /**
+     *  @brief  Samples by function name.
+     */
+    std::unordered_map<std::string, std::vector<double>> samples;
+
+    /**
+     *  @brief  Read the file, leaving the baseline empty if there is none.
+     *
+     *  @param  path  Path to the file.
+     *  @throws std::runtime_error  If the file is malformed.
+     */
+    auto load(const std::string &path) -> void;
+
+    /**
+     *  @brief  Write the file, replacing it atomically.
+     *
+     *  @param  path  Path to the file.
+     *  @throws std::runtime_error  If the file cannot be written.
+     */
+    auto save(const std::string &path) const -> void;
+
+    /**
+     *  @brief  Add samples of a function, keeping the latest @p window .
+     *
+     *  @param  name    Function name.
+     *  @param  values  Samples to add.
+     *  @param  window  Number of samples to keep.
+     */
+    auto record(
+        const std::string      &name,
+        std::span<const double> values,
+        std::size_t             window
+    ) -> void;
+};
+
+/**
+ *  @brief  Significant slowdown of a function compared to its baseline.
+ */
+struct performance_regression {
+
+    /**
+     *  @brief  Median of the baseline samples.
+     */
+    double baseline_median = 0.0;
+
+    /**
+     *  @brief  Median of the current samples.
+     */
+    double current_median = 0.0;
+
+    /**
+     *  @brief  p-value of the current samples not being slower.
+     */
+    double p_value = 1.0;
+};
+
+/**
+ *  @brief  Gate on performance regressions against a baseline file.
+ *
+ *  In update mode, the measurements of passing tests or benchmarks are
+ *  added to the baseline file.  Otherwise, a measurement is a regression if
+ *  its median is more than @c threshold slower than the baseline median and
+ *  the Mann-Whitney U test finds it slower with p-value below
+ *  @c significance .
+ */
+struct regression_gate {
+
+    /**
+     *  @brief  Path to the baseline file, empty to disable the gate.
+     */
+    std::string path;
+
+    /**
+     *  @brief  Add measurements to the baseline instead of comparing.
+     */
+    bool update = false;
+
+    /**
+     *  @brief  Number of latest samples kept per function.
+     */
+    std::size_t window = 30;
+
+    /**
+     *  @brief  Relative slowdown of the median that is tolerated.
+     */
+    double threshold = 0.1;
+
+    /**
+     *  @brief  Largest p-value of a significant slowdown.
+     */
+    double significance = 0.05;
+
+    /**
+     *  @brief  Baseline loaded by @c begin .
+     */
+    performance_baseline loaded;
+
+    /**
+     *  @brief  Samples recorded in update mode by function name, merged into
+     *          the baseline file by @c end .
+     */
+    std::unordered_map<std::string, std::vector<double>> recorded;
+
+    /**
+     *  @brief  Number of functions not checked because their baseline has
+     *          too few samples for a regression to be significant.
+     */
+    std::size_t underpowered = 0;
+
+    /**
+     *  @brief  Most baseline samples needed by a function counted in
+     *          @c underpowered .
+     */
+    std::size_t required_samples = 0;
+
+    /**
+     *  @brief   Check if the gate is enabled.
+     *  @return  True if there is a baseline file.
+     */
+    [[nodiscard]] inline auto enabled() const { return !path.empty(); }
+
+    /**
+     *  @brief  Load the baseline file, if enabled.
+     */
+    auto begin() -> void;
+
+    /**
+     *  @brief   Compare samples of a function to its baseline, or record
+     *           them in update mode.
+     *
+     *  @param   name    Function name.
+     *  @param   values  Samples.
+     *  @return  The regression, or nothing if not regressed, not enabled,
+     *           in update mode or without enough baseline samples.
+     */
+    [[nodiscard]] auto check(
+        const std::string      &name,
+        std::span<const double> values
+    ) -> std::optional<performance_regression>;
+
+    /**
+     *  @brief  Merge the recorded samples into the baseline file in update
+     *          mode, under a lock so that concurrent runs (e.g., shards) do
+     *          not lose each other's samples, and log how many functions
+     *          had too few baseline samples.
+     */
+    auto end() -> void;
+};
+
+/**
+ *  @brief   Escape text for an XML attribute or element.
+ *
+ *  @param   text  Text to escape.
+ *  @return  Escaped text.
+ */
+[[nodiscard]] auto xml_escape(std::string_view text) -> std::string;
+
+/**
+ *  @brief   Escape text for a JSON string, without the quotes.
+ *
+ *  @param   text  Text to escape.
+ *  @return  Escaped text.
+ */
+[[nodiscard]] auto json_escape(std::string_view text) -> std::string;
+
+/**
+ *  @brief   Get a hash of text that is the same on every platform and run,
+ *           unlike @c std::hash (64-bit FNV-1a).
+ *
+ *  @param   text  Text to hash.
+ *  @return  Hash of the text.
+ */
+[[nodiscard]] inline constexpr auto stable_hash(std::string_view text)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto &character : text)
+    {
+        hash ^= (std::uint8_t)character;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ *  @brief   Read a non-negative number from an environment variable.
+ *
+ *  @param   name  Name of the environment variable.
+ *  @return  The number, or nothing if the variable is not set.
+ */
+[[nodiscard]] inline auto read_environment_number(const char *name)
+-> std::optional<std::size_t>
+{
+    const char *value = std::getenv(name);
+    if (!value || !*value) return std::nullopt;
+
+    std::string_view text   = value;
+    std::size_t      number = 0;
+    auto [end, error] = std::from_chars(text.data(),
+        text.data() + text.size(), number);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+        throw std::invalid_argument(std::format(
+            "Environment variable {} is not a number: {}", name, text));
+    }
+    return number;
+}
+
+/**
+ *  @brief   Hash bytes eight at a time, for hashing large inputs quickly.
+ *
+ *  Not a cryptographic hash.  Chain calls through @p seed to hash an input
+ *  in chunks, which gives the same hash for the same chunk sizes.
+ *
+ *  @param   bytes  Bytes to hash.
+ *  @param   seed   Hash of the previous chunk, if any.
+ *  @return  Hash of the bytes.
+ */
+[[nodiscard]] inline auto hash_bytes(
+    std::span<const std::byte> bytes,
+    std::uint64_t              seed = 14695981039346656037ull
+)
+{
+    auto hash  = seed ^ (bytes.size() * 0x9E3779B97F4A7C15ull);
+    auto mix   = [&](std::uint64_t word) {
+        hash = std::rotl((hash ^ word) * 0x87C37B91114253D5ull, 31)
+             * 0x4CF5AD432745937Full;
+    };
+
+    std::size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + i, 8);
+        mix(word);
+    }
+    if (i < bytes.size())
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + i, bytes.size() - i);
+        mix(word);
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ *  @brief   Hash the running executable.
+ *
+ *  @return  Hash of the executable file.
+ *  @throws  std::runtime_error  If the executable cannot be read.
+ */
+[[nodiscard]] auto executable_fingerprint() -> std::uint64_t;
+
+/**
+ *  @brief  Cache of passed tests, to skip them in later runs with the same
+ *          inputs.
+ *
+ *  A test is keyed by @c fingerprint and its function name.  The file is
+ *  binary and read in one go.  Writers lock the file and merge their
+ *  changes with what other writers saved meanwhile, and replace it
+ *  atomically, so concurrent runs can share it.
+ */
+struct result_cache {
+
+    /**
+     *  @brief  Path to the cache file, empty to disable the cache.
+     */
+    std::string path;
+
+    /**
+     *  @brief  Fingerprint of the inputs of the tests, 0 to use the hash of
+     *          the executable.
+     */
+    std::uint64_t fingerprint = 0;
+
+    /**
+     *  @brief  Age after which a passed test is forgotten, to keep the file
+     *          from growing with stale fingerprints.
+     */
+    std::chrono::seconds max_age = std::chrono::days(7);
+
+    /**
+     *  @brief  Time each cached test passed, by key.
+     */
+    std::unordered_map<std::uint64_t, std::int64_t> passed;
+
+    /**
+     *  @brief  Whether each test passed in this run, by key.
+     */
+    std::unordered_map<std::uint64_t, bool> changes;
+
+    /**
+     *  @brief   Check if the cache is enabled.
+     *  @return  True if there is a cache file.
+     */
+    [[nodiscard]] inline auto enabled() const { return !path.empty(); }
+
+    /**
+     *  @brief   Get the key of a test.
+     *
+     *  @param   function_name  Function name of the test.
+     *  @return  The key.
+     */
+    [[nodiscard]] inline auto key(std::string_view function_name) const
+    {
+        return stable_hash(function_name) ^ fingerprint;
+    }
+
+    /**
+     *  @brief  Compute the fingerprint if not set and load the cache file,
+     *          if enabled.
+     */
+    auto begin() -> void;
+
+    /**
+     *  @brief   Check if a test passed in an earlier run.
+     *
+     *  @param   function_name  Function name of the test.
+     *  @return  True if the test passed with the same fingerprint.
+     */
+    [[nodiscard]] auto contains(std::string_view function_name) const -> bool;
+
+    /**
+     *  @brief  Record whether a test passed.
+     *
+     *  @param  function_name  Function name of the test.
+     *  @param  test_passed    True if the test passed.
+     */
+    auto record(std::string_view function_name, bool test_passed) -> void;
+
+    /**
+     *  @brief  Save the changes to the cache file, if enabled.
+     *
+     *  @throws std::runtime_error  If the file cannot be written.
+     */
+    auto end() -> void;
+};
+
+/**
+ *  @brief  A category of tests.
+ */
+struct test_suite {
+
+    /**
+     *  @brief  All the tests.
+     */
+    std::vector<const test_case *> tests;
+
+    /**
+     *  @brief  Function to execute before a test.
+     */
+    callable<void (const test_case *)> pre_run;
+
+    /**
+     *  @brief  Function to execute after a test.
+     *  @note   @c test_result converts to @c CT_ERRORS_TYPE , so a function
+     *          taking the errors count instead works too.
+     */
+    callable<void (const test_case *, const test_result &)> post_run;
+
+    /**
+     *  @brief  Function to execute after a failed test. Return true to stop
+     *          further tests.
+     *  @note   Also executes @c post_run
+     */
+    callable<bool (const test_case *, CT_ERRORS_TYPE)> run_failed;
+
+    /**
+     *  @brief  How to execute the tests.
+     */
+    run_mode mode = run_mode::sequential;
+
+    /**
+     *  @brief  Number of worker threads for @c run_mode::parallel and
+     *          @c run_mode::async or worker processes for
+     *          @c run_mode::process , 0 to use hardware concurrency.
+     */
+    std::size_t workers = 0;
+
+    /**
+     *  @brief  Time a test may take before it fails, unless it has its own
+     *          @c test_case::timeout , 0 for no timeout.
+     *
+     *  A test that times out counts as one error.  In @c run_mode::process
+     *  its worker is killed, otherwise its thread is abandoned and keeps
+     *  running in the background, so the test must not use anything that
+     *  is destroyed after the run, including its @c test_case and this
+     *  suite.  In @c run_mode::sequential , the tests are run on a single
+     *  worker thread when there are timeouts.
+     */
+    std::chrono::nanoseconds default_timeout = {};
+
+    /**
+     *  @brief  Index of the shard of @c tests to run, in range
+     *          [0, @c shard_count ).
+     */
+    std::size_t shard_index = 0;
+
+    /**
+     *  @brief  Number of shards to split @c tests into, 0 to use environment
+     *          variables @c CONFER_SHARD_INDEX and @c CONFER_SHARD_COUNT , or
+     *          to not shard if they are not set.
+     */
+    std::size_t shard_count = 0;
+
+    /**
+     *  @brief  Recorded duration of tests in seconds by @c function_name ,
+     *          to balance shards by time rather than by number of tests.
+     */
+    std::unordered_map<std::string, double> shard_durations;
+
+    /**
+     *  @brief  Filter of the tests to run.
+     */
+    test_filter filter;
+
+    /**
+     *  @brief  Count hardware events of each test in
+     *          @c test_result::counters .
+     */
+    bool use_hardware_counters = false;
+
+    /**
+     *  @brief  Time the whole run may take, 0 for none.  Once it passes, the
+     *          run is stopped, and the tests that were running and the tests
+     *          that never started get one error each.
+     */
+    std::chrono::nanoseconds run_timeout = {};
+
+    /**
+     *  @brief  Stop source of the current run.
+     *
+     *  A stop is requested when @c run_failed returns true or
+     *  @c run_timeout passes, and can be requested from elsewhere.  Tests
+     *  that have not started are not run, and get one error each if
+     *  @c run_timeout passed.  Running tests see the stop through
+     *  @c current_stop_token and @c CT_CHECK_CANCELLED , and worker
+     *  processes are killed.  Only tests that return early or are killed
+     *  are marked @c test_result::cancelled , tests that complete keep their
+     *  result.
+     */
+    std::stop_source stop = {};
+
+    /**
+     *  @brief  Time the current run times out at, set by @c begin_run .
+     */
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+
+    /**
+     *  @brief  Skip tests that passed in an earlier run, see
+     *          @c test_result::cached .
+     */
+    result_cache cache;
+
+    /**
+     *  @brief  Gate on wall-clock time regressions of passing tests.  A
+     *          regression counts as one error of the test.
+     *
+     *  Each run adds one sample per test, so a regression can only be
+     *  significant with at least @c 1/significance baseline samples.
+     *  Tests with fewer are not checked, and their number is logged.
+     */
+    regression_gate baseline;
+
+    /**
+     *  @brief  Result of every test that ran in the last @c run .
+     */
+    std::vector<test_result> results;
+
+    /**
+     *  @brief  Reporters of test results, such as @c junit_reporter and
+     *          @c json_lines_reporter .
+     */
+    std::vector<test_reporter> reporters;
+
+    /**
+     *  @brief  Runs the selected tests in place of @c mode if set and it
+     *          returns results.  Set by @c static_test_suite to call its
+     *          test functions directly.
+     */
+    std::optional<std::vector<test_result>> (*run_direct)(test_suite &,
+        const std::vector<const test_case *> &) = nullptr;
+
+    /**
+     *  @brief   Get the tests that this shard runs.
+     *
+     *  Every shard computes the same assignment of all candidates, so shards on
+     *  different machines agree on it without communicating.  Tests are
+     *  ordered by weight (recorded duration, or the mean of the recorded
+     *  durations if missing, or 1 when nothing is recorded), then by a stable
+     *  hash of @c function_name , and each is assigned to the least loaded
+     *  shard.
+     *
+     *  @param   candidates  Tests to shard.
+     *  @return  Tests of this shard, in the order of @p candidates .
+     */
+    [[nodiscard]] inline auto shard_tests(
+        const std::vector<const test_case *> &candidates
+    ) const
+    {
+        std::size_t index = shard_index;
+        std::size_t count = shard_count;
+        if (count == 0)
+        {
+            count = read_environment_number("CONFER_SHARD_COUNT").value_or(1);
+            index = read_environment_number("CONFER_SHARD_INDEX").value_or(0);
+        }
+        if (count == 0 || index >= count)
+        {
+            throw std::out_of_range(std::format("Invalid shard {} of {}",
+                index, count));
+        }
+        if (count == 1) return candidates;
+
+        double default_weight = 1.0;
+        if (!shard_durations.empty())
+        {
+            default_weight = 0.0;
+            for (auto &[name, duration] : shard_durations)
+            {
+                default_weight += duration;
+            }
+            default_weight /= (double)shard_durations.size();
+        }
+
+        struct weighted_test {
+            std::size_t   index  = 0;
+            double        weight = 0.0;
+            std::uint64_t hash   = 0;
+        };
+
+        std::vector<weighted_test> weighted = {};
+        weighted.reserve(candidates.size());
+        for (std::size_t i = 0; i < candidates.size(); i++)
+        {
+            auto   it     = shard_durations.find(candidates[i]->function_name);
+            double weight = it != shard_durations.end() ? it->second
+                                                        : default_weight;
+            weighted.emplace_back(i, weight,
+                stable_hash(candidates[i]->function_name));
+        }
+
+        // Heaviest first, so the light tests even out the loads at the end
+        std::ranges::sort(weighted, [&](const auto &a, const auto &b) {
+            if (a.weight != b.weight) return a.weight > b.weight;
+            if (a.hash != b.hash) return a.hash < b.hash;
+            return a.index < b.index;
+        });
+
+        std::vector<double> loads(count, 0.0);
+        std::vector<bool>   selected_indices(candidates.size(), false);
+        for (auto &test : weighted)
+        {
+            std::size_t shard = (std::size_t)std::distance(loads.begin(),
+                std::ranges::min_element(loads));
+            loads[shard] += test.weight;
+            if (shard == index) selected_indices[test.index] = true;
+        }
+
+        std::vector<const test_case *> selected = {};
+        for (std::size_t i = 0; i < candidates.size(); i++)
+        {
+            if (selected_indices[i]) selected.emplace_back(candidates[i]);
+        }
+        return selected;
+    }
+
+    /**
+     *  @brief   Get the tests that pass @c filter .
+     *
+     *  The filter is compiled once, and is evaluated before any @c pre_run ,
+     *  so filtered out tests cost nothing.
+     *
+     *  @return  Tests that pass the filter, in the order of @c tests .
+     */
+    [[nodiscard]] inline auto filter_tests() const
+    {
+        if (filter.empty()) return tests;
+
+        auto matcher = compile_filter(filter);
+        std::vector<const test_case *> filtered = {};
+        for (auto test : tests)
+        {
+            if (matcher.matches(test->title, test->function_name, test->tags))
+            {
+                filtered.emplace_back(test);
+            }
+        }
+        return filtered;
+    }
+
+    /**
+     *  @brief   Get the tests that @c run runs, the tests of this shard that
+     *           pass @c filter .
+     *  @return  Selected tests, in the order of @c tests .
+     */
+    [[nodiscard]] inline auto select_tests() const
+    {
+        return shard_tests(filter_tests());
+    }
+
+    /**
+     *  @brief   Get the timeout of each test.
+     *
+     *  @param   selected  Tests to run.
+     *  @return  Timeout of each test, or empty if no test has a timeout.
+     */
+    [[nodiscard]] inline auto timeouts_of(
+        const std::vector<const test_case *> &selected
+    ) const
+    {
+        std::vector<std::chrono::nanoseconds> timeouts = {};
+        bool                                  any      = false;
+        timeouts.reserve(selected.size());
+        for (auto &test : selected)
+        {
+            auto timeout = test->timeout.count() != 0 ? test->timeout
+                                                      : default_timeout;
+            any = any || timeout.count() != 0;
+            timeouts.emplace_back(timeout);
+        }
+        if (!any) timeouts.clear();
+        return timeouts;
+    }
+
+    /**
+     *  @brief   Run a test and measure how long it took.
+     *
+     *  @param   test  Test to run.
+     *  @return  Result of the test.
+     */
+    [[nodiscard]] inline auto run_test(const test_case *test) const
+    {
+        return run_test(test, [&] { return test->run(); });
+    }
+
+    /**
+     *  @brief   Run a test through @p function , timing it.
+     *
+     *  @tparam  function_type  Type of function.
+     *  @param   test           Test to run.
+     *  @param   function       Function that runs the test.
+     *  @return  Result of the test.
+     */
+    template<typename function_type>
+    [[nodiscard]] inline auto run_test(
+        const test_case *test,
+        function_type  &&function
+    ) const -> test_result
+    {
+        auto previous_token     = std::exchange(current_stop_token,
+            stop.get_token());
+        auto previous_cancelled = std::exchange(current_test_cancelled,
+            false);
+
+        // A test that timed out is abandoned and may return after the suite
+        // is gone, so no member is read once it returns
+        bool counters = use_hardware_counters;
+
+        allocation_scope allocations = {};
+        allocations.restart_peak();
+        if (counters) start_hardware_counters();
+        auto wall_start = std::chrono::steady_clock::now();
+        auto cpu_start  = thread_cpu_time();
+
+        test_result result = { .test = test, .errors = function() };
+
+        result.cpu_time    = thread_cpu_time() - cpu_start;
+        result.wall_time   = std::chrono::steady_clock::now() - wall_start;
+        if (counters) result.counters = stop_hardware_counters();
+        result.allocations = allocations.stats();
+        result.cancelled   = std::exchange(current_test_cancelled,
+            previous_cancelled);
+
+        current_stop_token = std::move(previous_token);
+        return result;
+    }
+
+    /**
+     *  @brief   Check a passing test against @c baseline , and call the hooks
+     *           after a test.  Requests a stop if @c run_failed returns
+     *           true.
+     *
+     *  @param   result  Result of the test.
+     *  @return  True to stop further tests.
+     */
+    [[nodiscard]] inline auto finish_test(test_result &result)
+    {
+        if (result.cancelled)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                logln("{} did not finish before the run timed out",
+                    result.test->title);
+                CT_INCREMENT_ERRORS(result.errors);
+            }
+            else logln("{} cancelled", result.test->title);
+        }
+        else if (baseline.enabled() && !(CT_HAS_ERRORS(result.errors)))
+        {
+            double sample = std::chrono::duration<double, std::nano>(
+                result.wall_time).count();
+            auto regression = baseline.check(result.test->function_name,
+                std::span(&sample, 1));
+            if (regression)
+            {
+                logln("{} regressed: median {:.3f} ms -> {:.3f} ms, "
+                    "p-value {:.4f}", result.test->title,
+                    regression->baseline_median / 1e6,
+                    regression->current_median / 1e6, regression->p_value);
+                CT_INCREMENT_ERRORS(result.errors);
+            }
+        }
+
+        bool end_test = false;
+        if (CT_HAS_ERRORS(result.errors))
+        {
+            if (run_failed && run_failed(result.test, result.errors))
+            {
+                end_test = true;
+            }
+        }
+
+        if (post_run) post_run(result.test, result);
+        for (auto &reporter : reporters)
+        {
+            if (reporter.report) reporter.report(result);
+        }
+
+        if (end_test) stop.request_stop();
+        return end_test;
+    }
+
+    /**
+     *  @brief   Run tests one after another on the calling thread.
+     *
+     *  @param   selected  Tests to run.
+     *  @return  Result of each test that ran.
+     */
+    [[nodiscard]] inline constexpr auto run_sequential(
+        const std::vector<const test_case *> &selected
+    )
+    {
+        std::vector<test_result> results = {};
+        for (auto &test : selected)
+        {
+            if (stop.stop_requested()) break;
+            if (pre_run) pre_run(test);
+            auto &result = results.emplace_back(run_test(test));
+            if (finish_test(result)) break;
+        }
+        return results;
+    };
+
+    /**
+     *  @brief   Remove results of tests that did not run, which workers left
+     *           unset in a result per selected test.
+     *
+     *  @param   results  Result per selected test.
+     *  @return  Result of each test that ran.
+     */
+    [[nodiscard]] static inline constexpr auto remove_unset(
+        std::vector<test_result> &&results
+    )
+    {
+        std::erase_if(results, [&](const test_result &result) {
+            return result.test == nullptr;
+        });
+        return std::move(results);
+    }
+
+    /**
+     *  @brief   Run tests on a work-stealing thread pool.
+     *
+     *  The hooks are called under a lock, so they need not be thread-safe.
+     *  Tests that have not started yet are cancelled once a stop is
+     *  requested.
+     *
+     *  @param   selected      Tests to run.
+     *  @param   worker_count  Number of worker threads, 0 to use hardware
+     *                         concurrency.
+     *  @return  Result of each test that ran, in the order of @p selected .
+     */
+    [[nodiscard]] inline auto run_parallel(
+        const std::vector<const test_case *> &selected,
+        std::size_t                           worker_count
+    )
+    {
+        std::mutex               hooks_mutex;
+        std::vector<test_result> results(selected.size());
+        auto                     timeouts = timeouts_of(selected);
+
+        auto task = [&](std::size_t index) {
+            if (stop.stop_requested()) return false;
+
+            const test_case *test = selected[index];
+            {
+                std::scoped_lock lock(hooks_mutex);
+                if (pre_run) pre_run(test);
+            }
+
+            // The hook is not part of the timeout, and must not be timed out
+            // while it holds the lock the watchdog needs to report it
+            work_started();
+            auto result = run_test(test);
+
+            // Timed out, everything here may be gone already
+            if (!work_finished()) return true;
+
+            std::scoped_lock lock(hooks_mutex);
+            results[index] = std::move(result);
+            return !finish_test(results[index]);
+        };
+
+        auto timed_out = [&](std::size_t index) {
+            std::scoped_lock lock(hooks_mutex);
+            auto &result = results[index];
+            result.test      = selected[index];
+            result.wall_time = timeouts[index];
+
+            logln("{} timed out after {:.3f} ms", result.test->title,
+                to_milliseconds(timeouts[index]));
+            CT_INCREMENT_ERRORS(result.errors);
+            return !finish_test(result);
+        };
+
+        run_work_stealing(selected.size(), worker_count, task, timeouts,
+            timed_out);
+
+        return remove_unset(std::move(results));
+    }
+
+    /**
+     *  @brief   Run tests in a pool of worker processes.
+     *
+     *  @c pre_run is called in the worker before the test, @c post_run and
+     *  @c run_failed are called in the calling process once the result
+     *  arrived, after writing out the captured logs of the test.  A test
+     *  that crashed its worker counts as one error.  Once a stop is
+     *  requested, the running workers are killed.  @c CT_ERRORS_TYPE must
+     *  be trivially copyable to be sent back from a worker.
+     *
+     *  @param   selected  Tests to run.
+     *  @return  Result of each test that ran, in the order of @p selected .
+     */
+    [[nodiscard]] inline auto run_process(
+        const std::vector<const test_case *> &selected
+    )
+    {
+        if constexpr (!std::is_trivially_copyable_v<CT_ERRORS_TYPE>)
+        {
+            throw std::logic_error("run_mode::process requires trivially "
+                                   "copyable CT_ERRORS_TYPE");
+        }
+
+        // What a worker sends back
+        struct output_type {
+            CT_ERRORS_TYPE           errors;
+            std::chrono::nanoseconds wall_time;
+            std::chrono::nanoseconds cpu_time;
+            allocation_stats         allocations;
+            hardware_counters        counters;
+            bool                     cancelled;
+        };
+
+        std::vector<test_result> results(selected.size());
+        auto                     timeouts = timeouts_of(selected);
+
+        auto task = [&](std::size_t index) {
+            const test_case *test = selected[index];
+            if (pre_run) pre_run(test);
+
+            auto        result = run_test(test);
+            output_type output = {
+                result.errors, result.wall_time, result.cpu_time,
+                result.allocations, result.counters, result.cancelled
+            };
+
+            std::string bytes(sizeof(output_type), '\0');
+            std::memcpy(bytes.data(), static_cast<const void *>(&output),
+                sizeof(output_type));
+            return bytes;
+        };
+
+        auto done = [&](std::size_t index, process_result &&outcome) {
+            auto &result = results[index];
+            result.test = selected[index];
+
+            log("{}", outcome.log);
+
+            // A worker that died while sending its result sent only part of it
+            if (!outcome.cancelled && outcome.crash.empty()
+             && outcome.output.size() != sizeof(output_type))
+            {
+                outcome.crash = std::format("sent a result of {} bytes "
+                    "instead of {}", outcome.output.size(),
+                    sizeof(output_type));
+            }
+
+            if (outcome.cancelled)
+            {
+                result.cancelled = true;
+            }
+            else if (outcome.crash.empty())
+            {
+                output_type output = { result.errors, {}, {}, {}, {}, {} };
+                std::memcpy(static_cast<void *>(&output),
+                    outcome.output.data(), sizeof(output_type));
+                result.errors      = output.errors;
+                result.wall_time   = output.wall_time;
+                result.cpu_time    = output.cpu_time;
+                result.allocations = output.allocations;
+                result.counters    = output.counters;
+                result.cancelled   = output.cancelled;
+            }
+            else
+            {
+                logln("{} {}{}", result.test->title,
+                    outcome.timed_out ? "" : "crashed: ", outcome.crash);
+                CT_INCREMENT_ERRORS(result.errors);
+                if (outcome.timed_out) result.wall_time = timeouts[index];
+            }
+
+            return !finish_test(result) && !stop.stop_requested();
+        };
+
+        run_process_pool(selected.size(), workers, task, done, timeouts,
+            deadline, stop.get_token());
+
+        return remove_unset(std::move(results));
+    }
+
+    /**
+     *  @brief   Run a test on an @c async_executor , as a job of
+     *           @c run_async .
+     *
+     *  @param   test         Test to run.
+     *  @param   result       Result to set once the test finished.
+     *  @param   hooks_mutex  Lock for the hooks.
+     *  @param   exception    First exception thrown by a test.
+     *  @return  Job running the test.
+     */
+    [[nodiscard]] inline auto run_async_test(
+        const test_case    *test,
+        test_result        &result,
+        std::mutex         &hooks_mutex,
+        std::exception_ptr &exception
+    ) -> async_job
+    {
+        {
+            std::scoped_lock lock(hooks_mutex);
+            if (stop.stop_requested()) co_return;
+            if (pre_run) pre_run(test);
+        }
+
+        test_result finished  = { .test = test };
+        auto        wall_start = std::chrono::steady_clock::now();
+        bool        cancelled  = false;
+        try
+        {
+            if (test->async_function)
+            {
+                // Other tests run on this thread while it is suspended, so
+                // it records being cancelled in this job
+                auto task = test->async_function();
+                task.handle.promise().cancelled = &cancelled;
+                finished.errors = co_await task;
+            }
+            else
+            {
+                // A synchronous test blocks the thread it runs on
+                current_test_cancelled = false;
+                finished.errors = test->function();
+                cancelled = std::exchange(current_test_cancelled, false);
+            }
+        }
+        catch (...)
+        {
+            std::scoped_lock lock(hooks_mutex);
+            if (!exception) exception = std::current_exception();
+            stop.request_stop();
+            co_return;
+        }
+        finished.wall_time = std::chrono::steady_clock::now() - wall_start;
+        finished.cancelled = cancelled;
+
+        std::scoped_lock lock(hooks_mutex);
+        result = std::move(finished);
+        (void)finish_test(result);
+    }
+
+    /**
+     *  @brief   Start every test at once on an @c async_executor with
+     *           @c workers threads.
+     *
+     *  Async tests overlap while they are suspended, synchronous tests block
+     *  an executor thread while they run.  The hooks are called under a lock.
+     *  Timeouts of single tests are not applied, and CPU time, allocations
+     *  and hardware events are not measured, as tests share threads.  If a
+     *  test throws, the run is stopped and the first exception is rethrown
+     *  once every test finished.
+     *
+     *  @param   selected  Tests to run.
+     *  @return  Result of each test that ran, in the order of @p selected .
+     */
+    [[nodiscard]] inline auto run_async(
+        const std::vector<const test_case *> &selected
+    )
+    {
+        async_executor           executor    = {};
+        std::mutex               hooks_mutex = {};
+        std::exception_ptr       exception   = nullptr;
+        std::vector<test_result> results(selected.size());
+
+        for (std::size_t index = 0; index < selected.size(); index++)
+        {
+            run_async_test(selected[index], results[index], hooks_mutex,
+                exception).start(executor);
+        }
+        executor.run(workers, stop.get_token());
+
+        if (exception) std::rethrow_exception(exception);
+        return remove_unset(std::move(results));
+    }
+
+    /**
+     *  @brief   Reset @c stop and @c deadline , and call the reporters before
+     *           the tests.
+     *
+     *  @return  Thread requesting a stop once @c run_timeout passes, to keep
+     *           until the run ends.
+     */
+    [[nodiscard]] inline auto begin_run() -> std::jthread
+    {
+        stop     = std::stop_source();
+        deadline = std::chrono::steady_clock::time_point::max();
+
+        cache.begin();
+        baseline.begin();
+        for (auto &reporter : reporters)
+        {
+            if (reporter.begin) reporter.begin();
+        }
+
+        if (run_timeout.count() == 0) return {};
+        deadline = std::chrono::steady_clock::now() + run_timeout;
+        return request_stop_at(stop, deadline);
+    }
+
+    /**
+     *  @brief   Add the tests that passed in an earlier run to @c results as
+     *           cached, and report them.
+     *
+     *  @param   selected  Selected tests.
+     *  @return  Tests that are not cached.
+     */
+    [[nodiscard]] inline auto skip_cached(
+        const std::vector<const test_case *> &selected
+    ) -> std::vector<const test_case *>
+    {
+        if (!cache.enabled()) return selected;
+
+        std::vector<const test_case *> remaining = {};
+        for (auto test : selected)
+        {
+            if (!cache.contains(test->function_name))
+            {
+                remaining.emplace_back(test);
+                continue;
+            }
+
+            auto &result = results.emplace_back();
+            result.test   = test;
+            result.cached = true;
+            logln("{} passed in an earlier run, skipped", test->title);
+            for (auto &reporter : reporters)
+            {
+                if (reporter.report) reporter.report(result);
+            }
+        }
+        return remaining;
+    }
+
+    /**
+     *  @brief   Run the tests with @c run_direct , or as @c mode says.
+     *
+     *  @param   selected  Tests to run.
+     *  @return  Result of each test that ran.
+     */
+    [[nodiscard]] inline auto run_selected(
+        const std::vector<const test_case *> &selected
+    ) -> std::vector<test_result>
+    {
+        if (run_direct)
+        {
+            if (auto ran = run_direct(*this, selected)) return std::move(*ran);
+        }
+        if (mode == run_mode::process)
+        {
+            return run_process(selected);
+        }
+        if (mode == run_mode::async)
+        {
+            return run_async(selected);
+        }
+        if (mode == run_mode::parallel)
+        {
+            return run_parallel(selected, workers);
+        }
+        if (!timeouts_of(selected).empty())
+        {
+            // Cannot abandon the calling thread, run on a worker thread
+            return run_parallel(selected, 1);
+        }
+        return run_sequential(selected);
+    }
+
+    /**
+     *  @brief   Add a result with one error for each selected test that did
+     *           not run because the run timed out, and report them.
+     *
+     *  Without this, a run stopped by @c run_timeout between tests would
+     *  pass with the remaining tests silently left out.
+     *
+     *  @param   selected  Tests to run.
+     *  @param   ran       Result of each test that ran, in the order of
+     *                     @p selected .
+     *  @return  Result of each selected test, in the order of @p selected ,
+     *           or @p ran if the run did not time out.
+     */
+    [[nodiscard]] inline auto add_not_run(
+        const std::vector<const test_case *> &selected,
+        std::vector<test_result>            &&ran
+    ) -> std::vector<test_result>
+    {
+        if (ran.size() == selected.size()
+         || std::chrono::steady_clock::now() < deadline)
+        {
+            return std::move(ran);
+        }
+
+        std::vector<test_result> all = {};
+        all.reserve(selected.size());
+        std::size_t not_run = 0;
+        auto        next    = ran.begin();
+        for (auto test : selected)
+        {
+            if (next != ran.end() && next->test == test)
+            {
+                all.emplace_back(std::move(*next++));
+                continue;
+            }
+
+            auto &result = all.emplace_back();
+            result.test      = test;
+            result.cancelled = true;
+            CT_INCREMENT_ERRORS(result.errors);
+            not_run++;
+            for (auto &reporter : reporters)
+            {
+                if (reporter.report) reporter.report(result);
+            }
+        }
+
+        logln("{} tests not run before the run timed out", not_run);
+        return all;
+    }
+
+    /**
+     *  @brief  Call the reporters after the tests.  Also called when a test
+     *          throws, so that the reports are complete.
+     */
+    inline auto end_reporters() -> void
+    {
+        for (auto &reporter : reporters)
+        {
+            if (reporter.end) reporter.end();
+        }
+    }
+
+    /**
+     *  @brief   Call the reporters after the tests and collect the failed
+     *           tests from @c results .
+     *
+     *  @return  The titles and errors count of each failed test.
+     */
+    [[nodiscard]] inline auto end_run()
+    {
+        end_reporters();
+        if (cache.enabled())
+        {
+            for (auto &result : results)
+            {
+                if (result.cached) continue;
+                cache.record(result.test->function_name,
+                    !(CT_HAS_ERRORS(result.errors)) && !result.cancelled);
+            }
+            cache.end();
+        }
+        baseline.end();
+        log_flush();
+
+        std::vector<std::pair<const test_case *,
+            CT_ERRORS_TYPE>> failed_tests = {};
+        for (auto &result : results)
+        {
+            if (CT_HAS_ERRORS(result.errors))
+            {
+                failed_tests.emplace_back(result.test, result.errors);
+            }
+        }
+        return failed_tests;
+    }
+
+    /**
+     *  @brief   Run all tests.
+     *
+     *  The result of every test that ran, passed or failed, is stored in
+     *  @c results , after the results of cached tests.
+     *
+     *  @return  The titles and errors count of each failed test, in the order
+     *           of @c tests regardless of @c mode .
+     */
+    [[nodiscard]] inline constexpr auto run()
+    {
+        auto selected = select_tests();
+        auto timer    = begin_run();
+        results.clear();
+        try
+        {
+            selected = skip_cached(selected);
+            auto ran = add_not_run(selected, run_selected(selected));
+            results.insert(results.end(),
+                std::make_move_iterator(ran.begin()),
+                std::make_move_iterator(ran.end()));
+        }
+        catch (...)
+        {
+            end_reporters();
+            log_flush();
+            throw;
+        }
+        return end_run();
+    };
+};
+
+/**
+ *  @brief  Test for @c static_test_suite , which can be @c constexpr .
+ */
+struct static_test_case {
+
+    /**
+     *  @brief  Test title, useful to identify failed tests.
+     */
+    std::string_view title;
+
+    /**
+     *  @brief  Testing function's name.
+     */
+    std::string_view function_name;
+
+    /**
+     *  @brief  The function to test which returns the number of errors.
+     */
+    CT_ERRORS_TYPE (*function)() = nullptr;
+
+    /**
+     *  @brief  Time the test may take before it fails, 0 to use
+     *          @c test_suite::default_timeout .
+     */
+    std::chrono::nanoseconds timeout = {};
+
+    /**
+     *  @brief  Tags to select the test by, see @c test_filter .
+     */
+    std::span<const std::string_view> tags;
+
+    /**
+     *  @brief  The async function to test, used instead of @c function if
+     *          set.
+     */
+    test_task (*async_function)() = nullptr;
+};
+
+/**
+ *  @brief   Make a test from a @c static_test_case .
+ *
+ *  @param   test  Static test.
+ *  @return  The test.
+ */
+[[nodiscard]] inline auto to_test_case(const static_test_case &test)
+{
+    test_case made = {
+        .title         = std::string(test.title),
+        .function_name = std::string(test.function_name),
+        .timeout       = test.timeout,
+        .tags          = test.tags | std::ranges::to<std::vector<std::string>>()
+    };
+    if (test.function) made.function = test.function;
+    if (test.async_function) made.async_function = test.async_function;
+    return made;
+}
+
+/**
+ *  @brief  Test suite with the tests fixed at compile time.
+ *
+ *  In @c run_mode::sequential without timeouts, each test function is called
+ *  directly rather than through @c test_case::function , so it can be
+ *  inlined.  Otherwise the tests run like in @c test_suite .  This holds
+ *  when run through a @c test_suite reference too, as it is done by
+ *  @c test_suite::run_direct .  The hooks receive a @c test_case made from
+ *  each @c static_test_case .
+ *
+ *  @tparam  cases  Tests, @c constexpr objects with static storage.
+ */
+template<const static_test_case & ... cases>
+struct static_test_suite : test_suite {
+
+    /**
+     *  @brief  Number of tests.
+     */
+    static constexpr std::size_t size = sizeof...(cases);
+
+    /**
+     *  @brief  Tests, in the order of @p cases .
+     */
+    static constexpr std::array<const static_test_case *, size> static_tests
+        = { &cases ... };
+
+    /**
+     *  @brief  Tests passed to the hooks, in the order of @p cases .
+     */
+    static inline const std::array<test_case, size> test_cases = {
+        to_test_case(cases) ...
+    };
+
+    /**
+     *  @brief  Construct the test suite with all the tests.
+     */
+    inline static_test_suite()
+    {
+        for (auto &test : test_cases)
+        {
+            tests.emplace_back(&test);
+        }
+        run_direct = run_static_sequential;
+    }
+
+    /**
+     *  @brief   Get the index of a test in @c test_cases .
+     *
+     *  @param   test  Test.
+     *  @return  Index of the test, or nothing if it is not one of
+     *           @c test_cases .
+     */
+    [[nodiscard]] static inline auto index_of(const test_case *test)
+        -> std::optional<std::size_t>
+    {
+        std::less<const test_case *> less = {};
+        if (size == 0 || less(test, test_cases.data())
+         || !less(test, test_cases.data() + size))
+        {
+            return std::nullopt;
+        }
+        return (std::size_t)(test - test_cases.data());
+    }
+
+    /**
+     *  @brief   Run a test by calling its function directly.
+     *
+     *  @tparam  index    Index of the test.
+     *  @param   suite    Test suite running the test.
+     *  @param   results  Results to add the result to.
+     *  @return  True to stop further tests.
+     */
+    template<std::size_t index>
+    [[nodiscard]] static inline auto run_static(
+        test_suite               &suite,
+        std::vector<test_result> &results
+    )
+    {
+        constexpr auto function = static_tests[index]->function;
+        const test_case *test = &test_cases[index];
+
+        if (suite.stop.stop_requested()) return true;
+        if (suite.pre_run) suite.pre_run(test);
+        auto &result = results.emplace_back(suite.run_test(test, [&] {
+            if constexpr (function == nullptr) return test->run();
+            else return function();
+        }));
+        return suite.finish_test(result);
+    }
+
+    /**
+     *  @brief   Run tests one after another, calling test functions directly,
+     *           if the suite runs sequentially without timeouts and all the
+     *           tests are in @c test_cases .
+     *
+     *  @param   suite     Test suite running the tests.
+     *  @param   selected  Tests to run.
+     *  @return  Result of each test that ran, or nothing if the tests cannot
+     *           be run directly.
+     */
+    [[nodiscard]] static inline auto run_static_sequential(
+        test_suite                           &suite,
+        const std::vector<const test_case *> &selected
+    ) -> std::optional<std::vector<test_result>>
+    {
+        if (suite.mode != run_mode::sequential
+         || !suite.timeouts_of(selected).empty()
+         || !std::ranges::all_of(selected, [](auto test) {
+                return index_of(test).has_value();
+            }))
+        {
+            return std::nullopt;
+        }
+
+        std::array<bool, size> chosen = {};
+        for (auto test : selected)
+        {
+            chosen[*index_of(test)] = true;
+        }
+
+        std::vector<test_result> results = {};
+        results.reserve(selected.size());
+        bool end_test = false;
+
+        [&]<std::size_t ... index>(std::index_sequence<index ...>) {
+            ((end_test = end_test
+                      || (chosen[index] && run_static<index>(suite, results))),
+             ...);
+        }(std::make_index_sequence<size>());
+
+        return results;
+    }
+};
+
+/**
+ *  @brief  Registration of a test by @c CT_TEST , linked into a list
+ *          without allocating.
+ */
+struct test_registration {
+
+    /**
+     *  @brief  Registered test.
+     */
+    static_test_case test;
+
+    /**
+     *  @brief  Previously registered test.
+     */
+    const test_registration *next = nullptr;
+
+    /**
+     *  @brief  Register a test.  Must have static storage duration.
+     *
+     *  @param  test  Test to register.
+     */
+    inline test_registration(static_test_case test);
+};
+
+/**
+ *  @brief  Last registered test, the head of the list of registered tests.
+ */
+inline const test_registration *last_registration = nullptr;
+
+/**
+ *  @brief  Number of registered tests.
+ */
+inline std::size_t registration_count = 0;
+
+inline test_registration::test_registration(static_test_case test)
+    : test(test), next(last_registration)
+{
+    last_registration = this;
+    registration_count++;
+}
+
+/**
+ *  @brief  Tests registered by @c CT_TEST , with an index by
+ *          @c test_case::function_name .
+ */
+struct test_registry {
+
+    /**
+     *  @brief  Registered tests, in the order of registration.
+     */
+    std::vector<test_case> cases;
+
+    /**
+     *  @brief  Registered tests by function name.
+     */
+    std::unordered_map<std::string_view, const test_case *> index;
+
+    /**
+     *  @brief   Get all the registered tests, for @c test_suite::tests .
+     *  @return  Registered tests, in the order of registration.
+     */
+    [[nodiscard]] inline auto tests() const
+    {
+        std::vector<const test_case *> tests = {};
+        tests.reserve(cases.size());
+        for (auto &test : cases)
+        {
+            tests.emplace_back(&test);
+        }
+        return tests;
+    }
+
+    /**
+     *  @brief   Find a registered test by function name.
+     *
+     *  @param   function_name  Testing function's name.
+     *  @return  The test, or null if none has the name.
+     */
+    [[nodiscard]] inline auto find(std::string_view function_name) const
+        -> const test_case *
+    {
+        auto it = index.find(function_name);
+        return it == index.end() ? nullptr : it->second;
+    }
+};
+
+/**
+ *  @brief   Get the registry of tests registered by @c CT_TEST .
+ *
+ *  The registry is built on the first call, after all the tests are
+ *  registered during static initialization.  Tests registered afterwards
+ *  are not included.
+ *
+ *  @return  The registry.
+ *  @throws  std::logic_error  If two tests have the same function name.
+ */
+[[nodiscard]] inline auto registered_tests() -> const test_registry &
+{
+    static const test_registry registry = [] {
+        std::vector<const test_registration *> registrations = {};
+        registrations.reserve(registration_count);
+        for (auto registration = last_registration; registration;
+             registration = registration->next)
+        {
+            registrations.emplace_back(registration);
+        }
+
+        test_registry registry = {};
+        registry.cases.reserve(registrations.size());
+        registry.index.reserve(registrations.size());
+        for (auto registration : registrations | std::views::reverse)
+        {
+            registry.cases.emplace_back(to_test_case(registration->test));
+        }
+
+        // Cases do not move anymore, keys view the static names
+        for (std::size_t i = 0; i < registry.cases.size(); i++)
+        {
+            auto name = registrations[registrations.size() - 1 - i]
+                ->test.function_name;
+            if (!registry.index.emplace(name, &registry.cases[i]).second)
+            {
+                throw std::logic_error(std::format(
+                    "Test function {} is registered twice", name));
+            }
+        }
+        return registry;
+    }();
+    return registry;
+}
+
+/**
+ *  @brief   Get fancy default pre-run function for decorated title output.
+ *
+ *  @param   decor_char   Decoration character for before and after title.
+ *  @param   decor_count  Decoration character count.
+ *  @return  A decorator function.
+ */
+[[nodiscard]] inline auto default_pre_runner(
+    char        decor_char,
+    std::size_t decor_count = 1
+)
+{
+    std::string decor = std::ranges::views::repeat(decor_char, decor_count)
+                      | std::ranges::to<std::string>();
+    return [=](const test_case *test) {
+        logln("{} {} {}", decor, test->title, decor);
+    };
+}
+
+/**
+ *  @brief   Get fancy default post-run function for decorated title output.
+ *
+ *  @param   decor_char   Decoration character for before and after title.
+ *  @param   decor_count  Decoration character count.
+ *  @return  A decorator function.
+ */
+[[nodiscard]] inline auto default_post_runner(
+    char        decor_char,
+    std::size_t decor_count = 1
+)
+{
+    std::string decor = std::views::repeat(decor_char, decor_count)
+                        | std::ranges::to<std::string>();
+    return [=](const test_case *test, const test_result &result) {
+        if (allocation_tracker_installed)
+        {
+            logln("{} End of {}, {} errors in {:.3f} ms, {} allocations of {} "
+                "bytes {}\n", decor, test->title, result.errors,
+                to_milliseconds(result.wall_time),
+                result.allocations.allocations, result.allocations.bytes,
+                decor);
+            return;
+        }
+        logln("{} End of {}, {} errors in {:.3f} ms {}\n", decor, test->title,
+            result.errors, to_milliseconds(result.wall_time), decor);
+    };
+}
+
+/**
+ *  @brief   Terminate further tests after printing failed test title.
+ *  @return  A quitter function.
+ */
+[[nodiscard]] inline auto default_run_failed_quitter()
+{
+    return [=](const test_case *test, CT_ERRORS_TYPE errors) {
+        logln("{} failed, cannot conduct further tests.", test->title);
+        return true;
+    };
+}
+
+/**
+ *  @brief  Print all failed test's title and errors count.
+ *  @param  failed_tests  Failed test results.
+ */
+inline auto print_failed_tests(
+    const std::vector<std::pair<const test_case *,
+        CT_ERRORS_TYPE>> &failed_tests
+)
+{
+    if (failed_tests.empty()) return;
+
+    logln("Failed tests:");
+    for (auto &failed_test : failed_tests)
+    {
+        logln("  {}: {} errors", failed_test.first->title, failed_test.second);
+    }
+    log_flush();
+}
+
+/**
+ *  @brief   Get sum of number of errors in all failed tests.
+ *
+ *  @param   failed_tests  Failed test results.
+ *  @return  The number of total errors.
+ */
+[[nodiscard]] inline constexpr auto sum_failed_tests_errors(
+    const std::vector<std::pair<const test_case *,
         CT_ERRORS_TYPE>> &failed_tests
 )
 {
-    if (failed_tests.empty()) return;
+    CT_ERRORS_TYPE errors(CT_ERRORS_PARAMS);
+    std::ranges::for_each(failed_tests, [&](const auto &failed_test) {
+        CT_ADD_TO_ERRORS(errors, failed_test.second);
+    });
+    return errors;
+}
+
+/**
+ *  @brief  Print the slowest tests by wall-clock time, and the total time
+ *          of all tests.
+ *
+ *  @param  results  Test results.
+ *  @param  count    Number of slowest tests to print.
+ */
+inline auto print_slowest_tests(
+    const std::vector<test_result> &results,
+    std::size_t                     count = 10
+)
+{
+    if (results.empty()) return;
+
+    std::vector<const test_result *> sorted = {};
+    sorted.reserve(results.size());
+    std::chrono::nanoseconds total_wall_time = {};
+    std::chrono::nanoseconds total_cpu_time  = {};
+    for (auto &result : results)
+    {
+        sorted.emplace_back(&result);
+        total_wall_time += result.wall_time;
+        total_cpu_time  += result.cpu_time;
+    }
+
+    count = std::min(count, sorted.size());
+    std::ranges::partial_sort(sorted, sorted.begin() + (std::ptrdiff_t)count,
+        std::ranges::greater(), &test_result::wall_time);
+
+    logln("Slowest tests:");
+    for (auto &result : sorted | std::views::take(count))
+    {
+        logln("  {}: {:.3f} ms (CPU {:.3f} ms)", result->test->title,
+            to_milliseconds(result->wall_time),
+            to_milliseconds(result->cpu_time));
+    }
+    logln("Total of {} tests: {:.3f} ms (CPU {:.3f} ms)", results.size(),
+        to_milliseconds(total_wall_time), to_milliseconds(total_cpu_time));
+    log_flush();
+}
+
+/**
+ *  @brief   Get the wall-clock time of tests in seconds by
+ *           @c function_name , suitable for @c test_suite::shard_durations .
+ *
+ *  @param   results  Test results, cached tests are left out.
+ *  @return  Duration of each test.
+ */
+[[nodiscard]] inline auto test_durations(
+    const std::vector<test_result> &results
+)
+{
+    std::unordered_map<std::string, double> durations = {};
+    for (auto &result : results)
+    {
+        if (result.cached) continue;
+        durations[result.test->function_name] = std::chrono::duration<double>(
+            result.wall_time).count();
+    }
+    return durations;
+}
+
+/**
+ *  @brief   Format the errors count of a test result for a report.
+ *
+ *  @param   result  Test result.
+ *  @return  Errors count.
+ */
+[[nodiscard]] inline auto format_errors(const test_result &result)
+{
+    return std::format("{}", result.errors);
+}
+
+/**
+ *  @brief   Get a reporter writing JUnit XML to a file as tests finish.
+ *
+ *  Each test is written as a @c testcase element with @c test_case::title
+ *  as name, @c test_case::function_name as class name and wall-clock time,
+ *  and a @c failure element if it failed.  The test counts are left to the
+ *  consumer, as they are unknown until the end.
+ *
+ *  @param   path         Path to the file.
+ *  @param   buffer_size  Size of buffered text that is written out.
+ *  @return  A reporter.
+ */
+[[nodiscard]] inline auto junit_reporter(
+    std::string path,
+    std::size_t buffer_size = 64 * 1024
+)
+{
+    auto file = std::make_shared<report_file>();
+    file->buffer_size = buffer_size;
+
+    return test_reporter {
+        .begin  = [=]() {
+            file->open(path);
+            file->write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<testsuites>\n  <testsuite name=\"confer\">\n");
+        },
+        .report = [=](const test_result &result) {
+            auto title         = xml_escape(result.test->title);
+            auto function_name = xml_escape(result.test->function_name);
+            auto time          = std::chrono::duration<double>(
+                result.wall_time).count();
+
+            if (result.cached)
+            {
+                file->write(std::format("    <testcase name=\"{}\" "
+                    "classname=\"{}\" time=\"0\">\n      <skipped "
+                    "message=\"Passed in an earlier run\"/>\n    "
+                    "</testcase>\n", title, function_name));
+            }
+            else if (CT_HAS_ERRORS(result.errors))
+            {
+                file->write(std::format("    <testcase name=\"{}\" "
+                    "classname=\"{}\" time=\"{:.6f}\">\n      <failure "
+                    "message=\"{} errors\"/>\n    </testcase>\n", title,
+                    function_name, time, xml_escape(format_errors(result))));
+            }
+            else
+            {
+                file->write(std::format("    <testcase name=\"{}\" "
+                    "classname=\"{}\" time=\"{:.6f}\"/>\n", title,
+                    function_name, time));
+            }
+        },
+        .end    = [=]() {
+            file->write("  </testsuite>\n</testsuites>\n");
+            file->close();
+        }
+    };
+}
+
+/**
+ *  @brief   Get a reporter writing JSON Lines to a file as tests finish.
+ *
+ *  Each test is written as one JSON object with @c title ,
+ *  @c function_name , @c errors , @c passed , @c wall_time_ms and
+ *  @c cpu_time_ms , and @c allocations , @c allocated_bytes and
+ *  @c peak_bytes if the allocation tracker is installed, and @c cycles ,
+ *  @c instructions , @c branch_misses and @c cache_misses if counted, and
+ *  @c cached if skipped by the result cache.  @c errors is a number if
+ *  @c CT_ERRORS_TYPE is arithmetic, otherwise a string.
+ *
+ *  @param   path         Path to the file.
+ *  @param   buffer_size  Size of buffered text that is written out, 0 to
+ *                        write out every line.
+ *  @return  A reporter.
+ */
+[[nodiscard]] inline auto json_lines_reporter(
+    std::string path,
+    std::size_t buffer_size = 64 * 1024
+)
+{
+    auto file = std::make_shared<report_file>();
+    file->buffer_size = buffer_size;
+
+    return test_reporter {
+        .begin  = [=]() { file->open(path); },
+        .report = [=](const test_result &result) {
+            auto errors = format_errors(result);
+            if constexpr (!std::is_arithmetic_v<CT_ERRORS_TYPE>)
+            {
+                errors = std::format("\"{}\"", json_escape(errors));
+            }
+
+            auto record = std::format("{{\"title\":\"{}\",\"function_name\":"
+                "\"{}\",\"errors\":{},\"passed\":{},\"wall_time_ms\":{:.6f},"
+                "\"cpu_time_ms\":{:.6f}", json_escape(result.test->title),
+                json_escape(result.test->function_name), errors,
+                !(CT_HAS_ERRORS(result.errors)),
+                to_milliseconds(result.wall_time),
+                to_milliseconds(result.cpu_time));
+
+            if (allocation_tracker_installed)
+            {
+                auto &allocations = result.allocations;
+                std::format_to(std::back_inserter(record), ",\"allocations\":"
+                    "{},\"allocated_bytes\":{},\"peak_bytes\":{}",
+                    allocations.allocations, allocations.bytes,
+                    allocations.peak_bytes);
+            }
+
+            auto add_counter = [&](std::string_view name, auto value) {
+                if (!value) return;
+                std::format_to(std::back_inserter(record), ",\"{}\":{}", name,
+                    *value);
+            };
+            add_counter("cycles", result.counters.cycles);
+            add_counter("instructions", result.counters.instructions);
+            add_counter("branch_misses", result.counters.branch_misses);
+            add_counter("cache_misses", result.counters.cache_misses);
+
+            if (result.cached) record += ",\"cached\":true";
+            record += "}\n";
+            file->write(record);
+        },
+        .end    = [=]() { file->close(); }
+    };
+}
+
+#ifndef CT_BENCHMARK
+/**
+ *  @brief  Define a benchmark function, measuring the loop
+ *          @c while (state.keep_running()) .
+ */
+#define CT_BENCHMARK(name) \
+auto name(benchmark_state &state) -> void
+#endif // ifndef CT_BENCHMARK
+
+/**
+ *  @brief   Prevent the compiler from optimizing away the computation of
+ *           @p value .
+ *
+ *  @tparam  value_type  Type of value.
+ *  @param   value       Value to keep.
+ */
+template<typename value_type>
+inline auto do_not_optimize(const value_type &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile ("" : : "r,m" (value) : "memory");
+#else // if defined(__GNUC__) || defined(__clang__)
+    const volatile char *pointer = &reinterpret_cast<const volatile char &>(
+        value);
+    (void)*pointer;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif // if defined(__GNUC__) || defined(__clang__)
+}
+
+/**
+ *  @brief  Prevent the compiler from optimizing away or reordering writes to
+ *          memory around this point.
+ */
+inline auto clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile ("" : : : "memory");
+#else // if defined(__GNUC__) || defined(__clang__)
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif // if defined(__GNUC__) || defined(__clang__)
+}
+
+/**
+ *  @brief  State of a benchmark run, passed to the benchmark function.
+ */
+struct benchmark_state {
+
+    /**
+     *  @brief  Number of iterations to run.
+     */
+    std::size_t iterations = 1;
+
+    /**
+     *  @brief  Bytes processed in one iteration, to report bytes per second.
+     */
+    std::size_t bytes_per_iteration = 0;
+
+    /**
+     *  @brief  Items processed in one iteration, to report items per second.
+     */
+    std::size_t items_per_iteration = 0;
+
+    /**
+     *  @brief  Iterations left.
+     */
+    std::size_t remaining = 0;
+
+    /**
+     *  @brief  True once the measured loop started.
+     */
+    bool started = false;
+
+    /**
+     *  @brief  When the measured loop started.
+     */
+    std::chrono::steady_clock::time_point start = {};
+
+    /**
+     *  @brief  When the measured loop ended.
+     */
+    std::chrono::steady_clock::time_point stop = {};
+
+    /**
+     *  @brief  Count hardware events of the measured loop.
+     */
+    bool count_hardware = false;
+
+    /**
+     *  @brief  Hardware events of the measured loop, if counted.
+     */
+    hardware_counters counters = {};
+
+    /**
+     *  @brief   Continue the measured loop.  The first call starts the clock,
+     *           so setup before the loop is not measured.
+     *  @return  True while iterations are left.
+     */
+    [[nodiscard]] inline auto keep_running()
+    {
+        if (started && remaining != 0) [[likely]]
+        {
+            remaining--;
+            return true;
+        }
+        return keep_running_slow();
+    }
+
+    /**
+     *  @brief   Start or end the measured loop.
+     *  @return  True if iterations are left.
+     */
+    [[nodiscard]] inline auto keep_running_slow() -> bool
+    {
+        if (!started)
+        {
+            started = true;
+            if (count_hardware) start_hardware_counters();
+            start = std::chrono::steady_clock::now();
+            if (remaining != 0)
+            {
+                remaining--;
+                return true;
+            }
+        }
+        stop = std::chrono::steady_clock::now();
+        if (count_hardware) counters = stop_hardware_counters();
+        return false;
+    }
+
+    /**
+     *  @brief   Get the measured time.
+     *  @return  Measured time in nanoseconds.
+     */
+    [[nodiscard]] inline auto elapsed() const
+    {
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+};
+
+/**
+ *  @brief  Benchmark a function.
+ */
+struct benchmark_case {
+
+    /**
+     *  @brief  Benchmark title, useful to identify results.
+     */
+    std::string title;
+
+    /**
+     *  @brief  Benchmarking function's name.
+     */
+    std::string function_name;
+
+    /**
+     *  @brief  The function to benchmark.
+     */
+    std::function<void (benchmark_state &)> function;
+
+    /**
+     *  @brief   Run the benchmark for a number of iterations.
+     *
+     *  @param   iterations      Number of iterations.
+     *  @param   count_hardware  Count hardware events of the measured loop.
+     *  @return  The state after the run.
+     */
+    [[nodiscard]] inline auto run(
+        std::size_t iterations,
+        bool        count_hardware = false
+    ) const
+    {
+        benchmark_state state = {
+            .iterations     = iterations,
+            .remaining      = iterations,
+            .count_hardware = count_hardware
+        };
+        if (count_hardware) start_hardware_counters();
+        state.start = std::chrono::steady_clock::now();
+        function(state);
+
+        // The function did not use the measured loop, measure whole call
+        if (!state.started)
+        {
+            state.stop = std::chrono::steady_clock::now();
+            if (count_hardware) state.counters = stop_hardware_counters();
+        }
+        return state;
+    }
+};
+
+/**
+ *  @brief  Measurements of a benchmark.
+ */
+struct benchmark_result {
+
+    /**
+     *  @brief  The benchmark.
+     */
+    const benchmark_case *benchmark = nullptr;
+
+    /**
+     *  @brief  Iterations in each sample.
+     */
+    std::size_t iterations = 0;
+
+    /**
+     *  @brief  Nanoseconds per iteration of each sample.
+     */
+    std::vector<double> samples;
+
+    /**
+     *  @brief  Mean nanoseconds per iteration.
+     */
+    double mean = 0.0;
+
+    /**
+     *  @brief  Median nanoseconds per iteration.
+     */
+    double median = 0.0;
+
+    /**
+     *  @brief  Standard deviation of nanoseconds per iteration.
+     */
+    double stddev = 0.0;
+
+    /**
+     *  @brief  Minimum nanoseconds per iteration.
+     */
+    double min = 0.0;
+
+    /**
+     *  @brief  Maximum nanoseconds per iteration.
+     */
+    double max = 0.0;
+
+    /**
+     *  @brief  Bytes processed per second, 0 if not reported.
+     */
+    double bytes_per_second = 0.0;
+
+    /**
+     *  @brief  Items processed per second, 0 if not reported.
+     */
+    double items_per_second = 0.0;
+
+    /**
+     *  @brief  Hardware events of all samples together, if counted.
+     */
+    hardware_counters counters = {};
+
+    /**
+     *  @brief  Regression against @c benchmark_suite::baseline , if any.
+     */
+    std::optional<performance_regression> regression;
+};
+
+/**
+ *  @brief   Compute statistics of the samples of a benchmark result.
+ *  @param   result  Result with samples to compute statistics of.
+ */
+inline auto compute_statistics(benchmark_result &result)
+{
+    auto &samples = result.samples;
+    if (samples.empty()) return;
+
+    std::vector<double> sorted = samples;
+    std::ranges::sort(sorted);
+
+    std::size_t count  = sorted.size();
+    double      sum    = 0.0;
+    for (auto &sample : sorted) sum += sample;
+
+    result.mean   = sum / (double)count;
+    result.median = count % 2 == 1
+                  ? sorted[count / 2]
+                  : (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+    result.min    = sorted.front();
+    result.max    = sorted.back();
+
+    double variance = 0.0;
+    for (auto &sample : sorted)
+    {
+        variance += (sample - result.mean) * (sample - result.mean);
+    }
+    result.stddev = count > 1 ? std::sqrt(variance / (double)(count - 1))
+                              : 0.0;
+}
+
+/**
+ *  @brief  A category of benchmarks.
+ */
+struct benchmark_suite {
+
+    /**
+     *  @brief  All the benchmarks.
+     */
+    std::vector<const benchmark_case *> benchmarks;
+
+    /**
+     *  @brief  Function to execute before a benchmark.
+     */
+    std::function<void (const benchmark_case *)> pre_run;
+
+    /**
+     *  @brief  Function to execute after a benchmark.
+     */
+    std::function<void (const benchmark_result &)> post_run;
+
+    /**
+     *  @brief  Time to spend measuring each benchmark, split into
+     *          @c samples .
+     */
+    std::chrono::duration<double> target_time = std::chrono::seconds(1);
+
+    /**
+     *  @brief  Number of samples to take for each benchmark.
+     */
+    std::size_t samples = 10;
+
+    /**
+     *  @brief  Most iterations per sample, where calibration stops even if
+     *          a sample takes less than its share of @c target_time , as
+     *          for a body optimized to constant time.
+     */
+    std::size_t max_iterations = 1'000'000'000;
+
+    /**
+     *  @brief  Count hardware events of the samples in
+     *          @c benchmark_result::counters .
+     */
+    bool use_hardware_counters = false;
+
+    /**
+     *  @brief  Gate on time per iteration regressions, see
+     *          @c benchmark_result::regression .
+     */
+    regression_gate baseline;
+
+    /**
+     *  @brief   Find the number of iterations for a sample to take about
+     *           @c target_time / @c samples .
+     *
+     *  @param   benchmark  The benchmark.
+     *  @return  Number of iterations.
+     */
+    [[nodiscard]] inline auto calibrate(const benchmark_case *benchmark) const
+    {
+        double target = std::chrono::duration<double, std::nano>(
+            target_time).count() / (double)std::max<std::size_t>(samples, 1);
+
+        std::size_t iterations = 1;
+        while (true)
+        {
+            benchmark_state state   = benchmark->run(iterations);
+            double          elapsed = state.elapsed();
+            if (elapsed >= target || iterations >= max_iterations) break;
+
+            // A function that does not loop cannot be calibrated
+            if (!state.started || state.remaining != 0) return 1uz;
+
+            // Aim a bit over, and grow at most 100 times per round so that a
+            // noisy short measurement does not overshoot wildly
+            double scale = elapsed > 0.0 ? target / elapsed * 1.2 : 100.0;
+            scale = std::clamp(scale, 2.0, 100.0);
+            iterations = (std::size_t)std::min((double)iterations * scale,
+                (double)max_iterations);
+        }
+        return iterations;
+    }
+
+    /**
+     *  @brief   Measure a benchmark.
+     *
+     *  @param   benchmark  The benchmark.
+     *  @return  Measurements of the benchmark.
+     */
+    [[nodiscard]] inline auto measure(const benchmark_case *benchmark) const
+    {
+        benchmark_result result = {
+            .benchmark  = benchmark,
+            .iterations = calibrate(benchmark)
+        };
+
+        std::size_t bytes_per_iteration = 0;
+        std::size_t items_per_iteration = 0;
+        for (std::size_t i = 0; i < std::max<std::size_t>(samples, 1); i++)
+        {
+            benchmark_state state = benchmark->run(result.iterations,
+                use_hardware_counters);
+            result.samples.emplace_back(state.elapsed()
+                                      / (double)result.iterations);
+            result.counters += state.counters;
+            bytes_per_iteration = state.bytes_per_iteration;
+            items_per_iteration = state.items_per_iteration;
+        }
+
+        compute_statistics(result);
+        if (result.mean > 0.0)
+        {
+            result.bytes_per_second = (double)bytes_per_iteration * 1e9
+                                    / result.mean;
+            result.items_per_second = (double)items_per_iteration * 1e9
+                                    / result.mean;
+        }
+        return result;
+    }
+
+    /**
+     *  @brief   Run all benchmarks.
+     *  @return  Measurements of each benchmark.
+     */
+    [[nodiscard]] inline auto run()
+    {
+        baseline.begin();
+
+        std::vector<benchmark_result> results = {};
+        for (auto &benchmark : benchmarks)
+        {
+            if (pre_run) pre_run(benchmark);
+            auto &result = results.emplace_back(measure(benchmark));
+            if (baseline.enabled())
+            {
+                result.regression = baseline.check(benchmark->function_name,
+                    result.samples);
+            }
+            if (post_run) post_run(result);
+        }
+
+        baseline.end();
+        log_flush();
+        return results;
+    }
+};
+
+/**
+ *  @brief   Format a rate with a metric prefix.
+ *
+ *  @param   rate  Rate per second.
+ *  @param   unit  Unit of the rate.
+ *  @return  Formatted rate.
+ */
+[[nodiscard]] inline auto format_rate(double rate, std::string_view unit)
+{
+    constexpr std::string_view prefixes[] = { "", "k", "M", "G", "T" };
+
+    std::size_t prefix = 0;
+    while (rate >= 1000.0 && prefix + 1 < std::size(prefixes))
+    {
+        rate /= 1000.0;
+        prefix++;
+    }
+    return std::format("{:.2f} {}{}/s", rate, prefixes[prefix], unit);
+}
+
+/**
+ *  @brief  Print a benchmark result.
+ *  @param  result  Benchmark result.
+ */
+inline auto print_benchmark_result(const benchmark_result &result)
+{
+    logln("{}: {:.2f} ns/op (median {:.2f}, stddev {:.2f}, min {:.2f}, "
+          "max {:.2f}) over {} samples of {} iterations",
+        result.benchmark->title, result.mean, result.median, result.stddev,
+        result.min, result.max, result.samples.size(), result.iterations);
+
+    if (result.bytes_per_second > 0.0)
+    {
+        logln("  {}", format_rate(result.bytes_per_second, "B"));
+    }
+    if (result.items_per_second > 0.0)
+    {
+        logln("  {}", format_rate(result.items_per_second, "items"));
+    }
+
+    if (result.regression)
+    {
+        logln("  Regressed: median {:.2f} ns/op -> {:.2f} ns/op, p-value {:.4f}",
+            result.regression->baseline_median,
+            result.regression->current_median, result.regression->p_value);
+    }
+
+    auto &counters   = result.counters;
+    auto  operations = (double)(result.iterations * result.samples.size());
+    if (counters.cycles)
+    {
+        logln("  {:.2f} cycles/op", (double)*counters.cycles / operations);
+    }
+    if (counters.instructions)
+    {
+        logln("  {:.2f} instructions/op", (double)*counters.instructions
+                                        / operations);
+    }
+    if (counters.cycles && counters.instructions && *counters.cycles != 0)
+    {
+        logln("  {:.2f} instructions/cycle", (double)*counters.instructions
+                                           / (double)*counters.cycles);
+    }
+    if (counters.branch_misses)
+    {
+        logln("  {:.4f} branch misses/op", (double)*counters.branch_misses
+                                         / operations);
+    }
+    if (counters.cache_misses)
+    {
+        logln("  {:.4f} cache misses/op", (double)*counters.cache_misses
+                                        / operations);
+    }
+}
+
+/**
+ *  @brief   Count the benchmarks that regressed.
+ *
+ *  @param   results  Benchmark results.
+ *  @return  Number of regressed benchmarks.
+ */
+[[nodiscard]] inline auto count_regressions(
+    const std::vector<benchmark_result> &results
+)
+{
+    return (std::size_t)std::ranges::count_if(results, [](auto &result) {
+        return result.regression.has_value();
+    });
+}
+
+/**
+ *  @brief  Print all benchmark results.
+ *  @param  results  Benchmark results.
+ */
+inline auto print_benchmark_results(
+    const std::vector<benchmark_result> &results
+)
+{
+    for (auto &result : results) print_benchmark_result(result);
+    log_flush();
+}
+
+/**
+ *  @brief  Seeded random number generator for property tests (SplitMix64).
+ */
+struct random_source {
+
+    /**
+     *  @brief  Current state.
+     */
+    std::uint64_t state = 0;
+
+    /**
+     *  @brief   Scramble a number.
+     *
+     *  @param   value  Number to scramble.
+     *  @return  The scrambled number.
+     */
+    [[nodiscard]] static inline constexpr auto mix(std::uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     *  @brief   Get the independent generator of a case of a property.
+     *
+     *  @param   seed   Seed of the property.
+     *  @param   index  Index of the case.
+     *  @return  The generator.
+     */
+    [[nodiscard]] static inline constexpr auto for_case(
+        std::uint64_t seed,
+        std::size_t   index
+    )
+    {
+        return random_source { mix(seed ^ mix(index)) };
+    }
+
+    /**
+     *  @brief   Get the next random number.
+     *  @return  Random number.
+     */
+    [[nodiscard]] inline constexpr auto next()
+    {
+        state += 0x9E3779B97F4A7C15ull;
+        return mix(state);
+    }
+
+    /**
+     *  @brief   Get a random number below a bound.
+     *
+     *  @param   bound  Bound, must not be 0.
+     *  @return  Random number in [0, bound).
+     */
+    [[nodiscard]] inline constexpr auto below(std::uint64_t bound)
+    {
+        return next() % bound;
+    }
+
+    /**
+     *  @brief   Get a random number in [0, 1).
+     *  @return  Random number.
+     */
+    [[nodiscard]] inline constexpr auto unit()
+    {
+        return (double)(next() >> 11) * 0x1.0p-53;
+    }
+};
+
+/**
+ *  @brief  A generator of values of a property test.
+ *
+ *  @c generate makes a value from a random source and a size that grows over
+ *  the cases, @c shrink gives simpler values to try in place of a value that
+ *  failed, simplest first.  Write a struct like this to generate user types.
+ */
+template<typename generator_type>
+concept generator = requires (
+    const generator_type                      &gen,
+    random_source                             &random,
+    std::size_t                                size,
+    const typename generator_type::value_type &value
+) {
+    { gen.generate(random, size) }
+        -> std::convertible_to<typename generator_type::value_type>;
+    { gen.shrink(value) }
+        -> std::convertible_to<std::vector<typename generator_type::value_type>>;
+};
+
+/**
+ *  @brief  Generator of integers in [min, max], shrinking towards 0.
+ *
+ *  @tparam  type  Integer type.
+ */
+template<std::integral type>
+struct integral_generator {
+    using value_type = type;
+
+    /**
+     *  @brief  Smallest value.
+     */
+    type min = std::numeric_limits<type>::min();
+
+    /**
+     *  @brief  Largest value.
+     */
+    type max = std::numeric_limits<type>::max();
+
+    /**
+     *  @brief   Get the distance of a value from @c min .
+     *
+     *  @param   value  Value.
+     *  @return  The distance.
+     */
+    [[nodiscard]] inline constexpr auto offset(type value) const
+    {
+        return (std::uint64_t)value - (std::uint64_t)min;
+    }
+
+    /**
+     *  @brief   Get the value at a distance from @c min .
+     *
+     *  @param   distance  Distance.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto at(std::uint64_t distance) const
+    {
+        return (type)((std::uint64_t)min + distance);
+    }
+
+    /**
+     *  @brief   Get the value shrinking goes towards, 0 clamped in range.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto target() const
+    {
+        return std::clamp<type>(0, min, max);
+    }
+
+    /**
+     *  @brief   Generate a value, one in eight being @c min or @c max , and
+     *           half the rest within @p size of @c target .
+     *
+     *  @param   random  Random source.
+     *  @param   size    Size of the case.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto generate(
+        random_source &random,
+        std::size_t    size
+    ) const -> type
+    {
+        auto width = offset(max);
+        switch (random.below(16))
+        {
+            case 0: return min;
+            case 1: return max;
+            default: break;
+        }
+
+        if (random.below(2) == 0)
+        {
+            if (width == std::numeric_limits<std::uint64_t>::max())
+            {
+                return at(random.next());
+            }
+            return at(random.below(width + 1));
+        }
+
+        auto middle = offset(target());
+        auto delta  = random.below((std::uint64_t)size + 1);
+        if (random.below(2) == 0)
+        {
+            return at(middle - std::min(delta, middle));
+        }
+        return at(middle + std::min(delta, width - middle));
+    }
+
+    /**
+     *  @brief   Get values between @p value and @c target , from
+     *           @c target to the next value.
+     *
+     *  @param   value  Value to shrink.
+     *  @return  Simpler values.
+     */
+    [[nodiscard]] inline constexpr auto shrink(type value) const
+    {
+        std::vector<type> shrunk = {};
+        auto to   = offset(target());
+        auto from = offset(value);
+        if (from == to) return shrunk;
+
+        auto distance = from > to ? from - to : to - from;
+        shrunk.emplace_back(target());
+        for (auto step = distance / 2; step > 0; step /= 2)
+        {
+            shrunk.emplace_back(at(from > to ? from - step : from + step));
+        }
+        return shrunk;
+    }
+};
+
+/**
+ *  @brief  Generator of floating point numbers in [min, max], shrinking
+ *          towards 0.
+ *
+ *  @tparam  type  Floating point type.
+ */
+template<std::floating_point type>
+struct floating_generator {
+    using value_type = type;
+
+    /**
+     *  @brief  Smallest value.
+     */
+    type min = std::numeric_limits<type>::lowest();
+
+    /**
+     *  @brief  Largest value.
+     */
+    type max = std::numeric_limits<type>::max();
+
+    /**
+     *  @brief   Get the value shrinking goes towards, 0 clamped in range.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto target() const
+    {
+        return std::clamp<type>(0, min, max);
+    }
+
+    /**
+     *  @brief   Get the value at a fraction between two values.
+     *
+     *  @param   from      First value.
+     *  @param   to        Second value.
+     *  @param   fraction  Fraction in [0, 1).
+     *  @return  The value, without overflowing for far apart values.
+     */
+    [[nodiscard]] static inline constexpr auto between(
+        type   from,
+        type   to,
+        double fraction
+    )
+    {
+        return (type)(from * (1.0 - fraction) + to * fraction);
+    }
+
+    /**
+     *  @brief   Generate a value, one in eight being @c min or @c max , and
+     *           half the rest within @p size of @c target .
+     *
+     *  @param   random  Random source.
+     *  @param   size    Size of the case.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto generate(
+        random_source &random,
+        std::size_t    size
+    ) const -> type
+    {
+        switch (random.below(16))
+        {
+            case 0: return min;
+            case 1: return max;
+            default: break;
+        }
+
+        if (random.below(2) == 0) return between(min, max, random.unit());
+
+        auto spread = (type)size;
+        return between(std::max(min, target() - spread),
+            std::min(max, target() + spread), random.unit());
+    }
+
+    /**
+     *  @brief   Get @c target , the value without its fraction, powers of
+     *           two away from @c target and the value halfway to it, if in
+     *           range.
+     *
+     *  Powers of two find the magnitude of a counterexample in as many steps
+     *  as its exponent, rather than halving it one step at a time.
+     *
+     *  @param   value  Value to shrink.
+     *  @return  Simpler values.
+     */
+    [[nodiscard]] inline constexpr auto shrink(type value) const
+    {
+        std::vector<type> shrunk = {};
+        if (!std::isfinite(value) || value == target()) return shrunk;
+
+        auto add = [&](type simpler) {
+            if (simpler != value && simpler >= min && simpler <= max
+             && std::ranges::find(shrunk, simpler) == shrunk.end())
+            {
+                shrunk.emplace_back(simpler);
+            }
+        };
+
+        add(target());
+        add(std::trunc(value));
+        auto distance = value - target();
+        for (type power = 1; power < std::abs(distance); power *= 2)
+        {
+            add(target() + std::copysign(power, distance));
+        }
+        add(value - distance / 2);
+        return shrunk;
+    }
+};
+
+/**
+ *  @brief  Generator of booleans, shrinking to false.
+ */
+struct bool_generator {
+    using value_type = bool;
+
+    /**
+     *  @brief   Generate a value.
+     *
+     *  @param   random  Random source.
+     *  @return  The value.
+     */
+    [[nodiscard]] inline constexpr auto generate(
+        random_source &random,
+        std::size_t
+    ) const -> bool
+    {
+        return random.below(2) == 1;
+    }
+
+    /**
+     *  @brief   Get false for true.
+     *
+     *  @param   value  Value to shrink.
+     *  @return  Simpler values.
+     */
+    [[nodiscard]] inline constexpr auto shrink(bool value) const
+    {
+        return value ? std::vector { false } : std::vector<bool> {};
+    }
+};
+
+/**
+ *  @brief  Generator of containers of up to @c max_size elements, shrinking
+ *          by removing elements and then by shrinking elements.
+ *
+ *  @tparam  container_type     Container with @c insert at @c end .
+ *  @tparam  element_generator  Generator of the elements.
+ */
+template<typename container_type, generator element_generator>
+struct container_generator {
+    using value_type = container_type;
+
+    /**
+     *  @brief  Generator of the elements.
+     */
+    element_generator element = {};
+
+    /**
+     *  @brief  Largest number of elements.
+     */
+    std::size_t max_size = 100;
+
+    /**
+     *  @brief   Generate a container of up to @p size elements.
+     *
+     *  @param   random  Random source.
+     *  @param   size    Size of the case.
+     *  @return  The container.
+     */
+    [[nodiscard]] inline constexpr auto generate(
+        random_source &random,
+        std::size_t    size
+    ) const -> container_type
+    {
+        container_type container = {};
+        auto count = random.below(std::min(max_size, size) + 1);
+        for (std::uint64_t i = 0; i < count; i++)
+        {
+            container.insert(container.end(), element.generate(random, size));
+        }
+        return container;
+    }
+
+    /**
+     *  @brief   Get the container without all, half or one of its
+     *           elements, then with one element shrunk.
+     *
+     *  @param   value  Container to shrink.
+     *  @return  Simpler containers.
+     */
+    [[nodiscard]] inline constexpr auto shrink(const container_type &value) const
+    {
+        std::vector<container_type> shrunk = {};
+        auto size = (std::size_t)std::ranges::distance(value);
+        if (size == 0) return shrunk;
+
+        auto without = [&](std::size_t begin, std::size_t end) {
+            container_type removed = {};
+            std::size_t    index   = 0;
+            for (auto &&item : value)
+            {
+                if (index < begin || index >= end)
+                {
+                    removed.insert(removed.end(), item);
+                }
+                index++;
+            }
+            return removed;
+        };
+
+        shrunk.emplace_back();
+        if (size > 1)
+        {
+            shrunk.emplace_back(without(0, size / 2));
+            shrunk.emplace_back(without(size / 2, size));
+        }
+        for (std::size_t i = 0; i < size; i++)
+        {
+            shrunk.emplace_back(without(i, i + 1));
+        }
+
+        std::size_t index = 0;
+        for (auto &&item : value)
+        {
+            for (auto &&simpler : element.shrink(item))
+            {
+                shrunk.emplace_back(value);
+                *std::ranges::next(shrunk.back().begin(), index) = simpler;
+            }
+            index++;
+        }
+        return shrunk;
+    }
+};
+
+/**
+ *  @brief  Generator of tuples, shrinking one element at a time.
+ *
+ *  @tparam  element_generators  Generators of the elements.
+ */
+template<generator ... element_generators>
+struct tuple_generator {
+    using value_type = std::tuple<typename element_generators::value_type ...>;
+
+    /**
+     *  @brief  Generators of the elements.
+     */
+    std::tuple<element_generators ...> elements = {};
+
+    /**
+     *  @brief   Generate a tuple, elements in order.
+     *
+     *  @param   random  Random source.
+     *  @param   size    Size of the case.
+     *  @return  The tuple.
+     */
+    [[nodiscard]] inline constexpr auto generate(
+        random_source &random,
+        std::size_t    size
+    ) const -> value_type
+    {
+        return std::apply([&](auto &... gens) {
+            // Braced initialization evaluates in order
+            return value_type { gens.generate(random, size) ... };
+        }, elements);
+    }
+
+    /**
+     *  @brief   Get the tuple with one element shrunk.
+     *
+     *  @param   value  Tuple to shrink.
+     *  @return  Simpler tuples.
+     */
+    [[nodiscard]] inline constexpr auto shrink(const value_type &value) const
+    {
+        std::vector<value_type> shrunk = {};
+        [&]<std::size_t ... indices>(std::index_sequence<indices ...>) {
+            ([&] {
+                auto &gen = std::get<indices>(elements);
+                for (auto &&simpler : gen.shrink(std::get<indices>(value)))
+                {
+                    std::get<indices>(shrunk.emplace_back(value)) = simpler;
+                }
+            }(), ...);
+        }(std::index_sequence_for<element_generators ...>());
+        return shrunk;
+    }
+};
+
+/**
+ *  @brief   Get a generator of vectors.
+ *
+ *  @param   element   Generator of the elements.
+ *  @param   max_size  Largest number of elements.
+ *  @return  The generator.
+ */
+template<generator element_generator>
+[[nodiscard]] inline constexpr auto vector_of(
+    element_generator element,
+    std::size_t       max_size = 100
+)
+{
+    return container_generator<
+        std::vector<typename element_generator::value_type>,
+        element_generator> { element, max_size };
+}
+
+/**
+ *  @brief   Get a generator of printable ASCII strings.
+ *
+ *  @param   max_size  Largest length.
+ *  @return  The generator.
+ */
+[[nodiscard]] inline constexpr auto string_of(std::size_t max_size = 100)
+{
+    return container_generator<std::string, integral_generator<char>> {
+        { ' ', '~' }, max_size
+    };
+}
+
+/**
+ *  @brief   Get a generator of tuples, for properties of several values.
+ *
+ *  @param   elements  Generators of the elements.
+ *  @return  The generator.
+ */
+template<generator ... element_generators>
+[[nodiscard]] inline constexpr auto tuple_of(element_generators ... elements)
+{
+    return tuple_generator<element_generators ...> { { elements ... } };
+}
+
+/**
+ *  @brief  Options of a property test.
+ */
+struct property_options {
+
+    /**
+     *  @brief  Number of cases to check.
+     */
+    std::size_t cases = 100;
+
+    /**
+     *  @brief  Seed, 0 to use the @c CONFER_PROPERTY_SEED environment
+     *          variable or a random seed.
+     */
+    std::uint64_t seed = 0;
+
+    /**
+     *  @brief  Size of the last case, sizes grow from 0 over the cases.
+     */
+    std::size_t max_size = 100;
+
+    /**
+     *  @brief  Largest number of shrunk values to check.
+     */
+    std::size_t max_shrinks = 1000;
+
+    /**
+     *  @brief  Number of threads checking the cases, 0 to use hardware
+     *          concurrency, or one thread for a test run by a pool (see
+     *          @c nested_workers ).
+     */
+    std::size_t workers = 0;
+};
+
+/**
+ *  @brief  Result of a property test.
+ */
+struct property_result {
+
+    /**
+     *  @brief  True if the property held for every case.
+     */
+    bool passed = true;
+
+    /**
+     *  @brief  Seed the cases were generated from.
+     */
+    std::uint64_t seed = 0;
+
+    /**
+     *  @brief  Index of the first failing case, if any.
+     */
+    std::optional<std::size_t> failing_case;
+
+    /**
+     *  @brief  Number of times the failing value was shrunk.
+     */
+    std::size_t shrinks = 0;
+
+    /**
+     *  @brief  Minimal failing value, formatted if possible.
+     */
+    std::string counterexample;
+};
+
+/**
+ *  @brief   Format a value of a property test.
+ *
+ *  @param   value  Value.
+ *  @return  The formatted value, or a placeholder if not formattable.
+ */
+template<typename value_type>
+[[nodiscard]] inline auto format_property_value(const value_type &value)
+{
+    if constexpr (std::formattable<value_type, char>)
+    {
+        return std::format("{}", value);
+    }
+    else
+    {
+        return std::string("(not formattable)");
+    }
+}
+
+/**
+ *  @brief   Check a property for a value.
+ *
+ *  @param   property  Property, called with the value or with the elements
+ *                     of a tuple.
+ *  @param   value     Value.
+ *  @return  Nothing if the property held, otherwise how it failed.
+ */
+template<typename property_type, typename value_type>
+[[nodiscard]] inline auto evaluate_property(
+    const property_type &property,
+    const value_type    &value
+) -> std::optional<std::string>
+{
+    try
+    {
+        bool held = false;
+        if constexpr (std::invocable<const property_type &, const value_type &>)
+        {
+            held = std::invoke(property, value);
+        }
+        else
+        {
+            held = std::apply(property, value);
+        }
+        if (held) return std::nullopt;
+        return "returned false";
+    }
+    catch (const std::exception &exception)
+    {
+        return std::format("threw {}", exception.what());
+    }
+    catch (...)
+    {
+        return "threw an unknown exception";
+    }
+}
+
+/**
+ *  @brief   Check a property for generated values, and shrink a failing
+ *           value to a minimal counterexample.
+ *
+ *  The cases are checked in chunks on a work-stealing pool, so
+ *  @p property must be thread-safe.  Each case has its own random source
+ *  derived from the seed and its index, so the first failing case and its
+ *  counterexample do not depend on the number of workers.  The failure is
+ *  logged along with the seed to reproduce it.  Stops early once the run of
+ *  the test is stopped, see @c current_stop_token .
+ *
+ *  @param   name      Name of the property.
+ *  @param   gen       Generator of the values.
+ *  @param   property  Property, called with a value or with the elements of
+ *                     a tuple, returns true if it holds.  Throwing counts as
+ *                     failing.
+ *  @param   options   Options.
+ *  @return  The result.
+ */
+template<generator generator_type, typename property_type>
+inline auto check_property(
+    std::string_view        name,
+    const generator_type   &gen,
+    const property_type    &property,
+    const property_options &options = {}
+) -> property_result
+{
+    property_result result = { .seed = options.seed };
+    if (result.seed == 0)
+    {
+        auto seed   = read_environment_number("CONFER_PROPERTY_SEED");
+        result.seed = seed ? *seed : ((std::uint64_t)std::random_device()()
+            << 32 | std::random_device()());
+    }
+
+    auto size_of = [&](std::size_t index) {
+        return options.max_size * index / std::max<std::size_t>(
+            options.cases - 1, 1);
+    };
+    auto value_of = [&](std::size_t index) {
+        auto random = random_source::for_case(result.seed, index);
+        return gen.generate(random, size_of(index));
+    };
+
+    constexpr std::size_t chunk_size = 256;
+
+    // Chunks past a failure are skipped, but all chunks before it are
+    // checked, so the first failing case is found regardless of scheduling
+    std::atomic<std::size_t> first_failure = options.cases;
+    auto chunks = (options.cases + chunk_size - 1) / chunk_size;
+    auto token  = current_stop_token;
+
+    // How the first failing case of each chunk failed
+    std::vector<std::string> failures(chunks);
+    std::atomic<bool>        stopped = false;
+    run_work_stealing(chunks, nested_workers(options.workers),
+        [&](std::size_t chunk) {
+        if (token.stop_requested())
+        {
+            stopped.store(true, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto begin = chunk * chunk_size;
+        auto end   = std::min(begin + chunk_size, options.cases);
+        for (auto index = begin; index < end; index++)
+        {
+            if (index >= first_failure.load(std::memory_order_relaxed)) break;
+            auto first = evaluate_property(property, value_of(index));
+            if (!first) continue;
+            failures[chunk] = std::move(*first);
+
+            auto failure = first_failure.load(std::memory_order_relaxed);
+            while (index < failure && !first_failure.compare_exchange_weak(
+                failure, index, std::memory_order_relaxed));
+            break;
+        }
+        return true;
+    });
+
+    if (stopped) current_test_cancelled = true;
+    if (first_failure == options.cases) return result;
+
+    result.passed       = false;
+    result.failing_case = first_failure.load();
+
+    // Take the first simpler value that still fails, until none does.  A
+    // property that is not deterministic may pass when checked again
+    auto        value   = value_of(*result.failing_case);
+    auto        failure = evaluate_property(property, value).value_or(
+        std::move(failures[*result.failing_case / chunk_size]));
+    std::size_t checked = 0;
+    for (bool shrunk = true; shrunk && checked < options.max_shrinks;)
+    {
+        shrunk = false;
+        for (auto &&simpler : gen.shrink(value))
+        {
+            if (checked++ >= options.max_shrinks) break;
+
+            // Shrinking a bool gives a proxy, checked as the value it refers
+            const typename generator_type::value_type &candidate = simpler;
+            if (auto simpler_failure = evaluate_property(property, candidate))
+            {
+                value   = std::move(simpler);
+                failure = std::move(*simpler_failure);
+                shrunk  = true;
+                result.shrinks++;
+                break;
+            }
+        }
+    }
+
+    result.counterexample = format_property_value(value);
+    logln("Property {} failed at case {} of {} (seed {}), shrunk {} times: "
+        "{}: {}", name, *result.failing_case, options.cases, result.seed,
+        result.shrinks, failure, result.counterexample);
+    return result;
+}
+
+#ifndef CT_ASSERT_PROPERTY
+/**
+ *  @brief  Assert that a property holds, arguments as @c check_property .
+ */
+#define CT_ASSERT_PROPERTY(name, ...)                                      \
+if (!check_property(name, __VA_ARGS__).passed) [[unlikely]]              \
+{                                                                          \
+    CT_INCREMENT_ERRORS(CT_ERRORS);                                        \
+}                                                                          \
+do {} while (false)
+#endif // ifndef CT_ASSERT_PROPERTY
+
+/**
+ *  @brief  Errors counter that can be incremented from any thread, made of
+ *          atomic counters on separate cache lines that threads spread over.
+ *
+ *  Use @c CT_BEGIN_CONCURRENT to declare it as the errors counter of a
+ *  test.  It converts to @c CT_ERRORS_TYPE when the test returns.
+ */
+struct concurrent_errors {
+
+    /**
+     *  @brief  Number of counters.
+     */
+    static constexpr std::size_t shard_count = 16;
+
+    /**
+     *  @brief  A counter on its own cache line.
+     */
+    struct alignas(64) shard {
+        std::atomic<std::size_t> count = 0;
+    };
+
+    /**
+     *  @brief  The counters.
+     */
+    std::array<shard, shard_count> shards = {};
+
+    /**
+     *  @brief   Get the counter of the calling thread.
+     *  @return  Index of the counter.
+     */
+    [[nodiscard]] static inline auto shard_index()
+    {
+        static std::atomic<std::size_t> next_index = 0;
+        thread_local std::size_t index = next_index++ % shard_count;
+        return index;
+    }
+
+    /**
+     *  @brief  Count an error.
+     */
+    inline auto operator++(int)
+    {
+        shards[shard_index()].count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     *  @brief   Count errors.
+     *
+     *  @param   number  Number of errors.
+     *  @return  This counter.
+     */
+    inline auto operator+=(std::size_t number) -> concurrent_errors &
+    {
+        shards[shard_index()].count.fetch_add(number,
+            std::memory_order_relaxed);
+        return *this;
+    }
+
+    /**
+     *  @brief   Get the number of errors counted so far.
+     *  @return  Errors count.
+     */
+    [[nodiscard]] inline auto count() const
+    {
+        std::size_t total = 0;
+        for (auto &shard : shards)
+        {
+            total += shard.count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     *  @brief   Compare the errors count with a number.
+     *
+     *  @param   number  Number.
+     *  @return  True if equal.
+     */
+    [[nodiscard]] inline auto operator==(std::size_t number) const
+    {
+        return count() == number;
+    }
+
+    /**
+     *  @brief   Get the errors count.
+     *  @return  Errors count as @c CT_ERRORS_TYPE .
+     */
+    [[nodiscard]] inline operator CT_ERRORS_TYPE() const
+    {
+        CT_ERRORS_TYPE errors = CT_ERRORS_TYPE(CT_ERRORS_PARAMS);
+        add_errors(errors, count());
+        return errors;
+    }
+};
+
+/**
+ *  @brief  Options of a stress test.
+ */
+struct stress_options {
+
+    /**
+     *  @brief  Number of threads, 0 to use hardware concurrency.
+     */
+    std::size_t threads = 0;
+
+    /**
+     *  @brief  Number of times each thread runs the body.
+     */
+    std::size_t iterations = 1000;
+
+    /**
+     *  @brief  Time to run the body for, used instead of @c iterations if
+     *          not 0.
+     */
+    std::chrono::nanoseconds duration = {};
+};
+
+/**
+ *  @brief  Result of a stress test.
+ */
+struct stress_result {
+
+    /**
+     *  @brief  Number of failed runs of the body of each thread.
+     */
+    std::vector<std::size_t> failures;
+
+    /**
+     *  @brief  Number of runs of the body of each thread.
+     */
+    std::vector<std::size_t> operations;
+
+    /**
+     *  @brief  Time from releasing the threads until the last finished.
+     */
+    std::chrono::nanoseconds wall_time = {};
+
+    /**
+     *  @brief   Get the number of failed runs of all threads.
+     *  @return  Number of failed runs.
+     */
+    [[nodiscard]] inline auto total_failures() const
+    {
+        std::size_t total = 0;
+        for (auto count : failures) total += count;
+        return total;
+    }
+
+    /**
+     *  @brief   Get the number of runs of all threads.
+     *  @return  Number of runs.
+     */
+    [[nodiscard]] inline auto total_operations() const
+    {
+        std::size_t total = 0;
+        for (auto count : operations) total += count;
+        return total;
+    }
+
+    /**
+     *  @brief   Get the number of runs per second of all threads.
+     *  @return  Runs per second.
+     */
+    [[nodiscard]] inline auto operations_per_second() const
+    {
+        auto seconds = std::chrono::duration<double>(wall_time).count();
+        return seconds > 0.0 ? (double)total_operations() / seconds : 0.0;
+    }
+};
+
+/**
+ *  @brief   Run a body on several threads at once.
+ *
+ *  The threads are released together by a barrier, then each runs the body
+ *  for @c stress_options::iterations times or until
+ *  @c stress_options::duration passed.  They stop early once the run of
+ *  the test is stopped, see @c current_stop_token .
+ *
+ *  @param   body     Called with the index of the thread.  Returning false
+ *                    or throwing counts as a failure of the thread.
+ *  @param   options  Options.
+ *  @return  The result.
+ */
+template<std::invocable<std::size_t> body_type>
+inline auto run_stress(body_type &&body, const stress_options &options = {})
+-> stress_result
+{
+    auto threads = options.threads != 0 ? options.threads
+                                        : std::thread::hardware_concurrency();
+    threads = std::max<std::size_t>(threads, 1);
+
+    stress_result result = {
+        .failures   = std::vector<std::size_t>(threads),
+        .operations = std::vector<std::size_t>(threads)
+    };
+
+    auto token = current_stop_token;
+    bool timed = options.duration.count() != 0;
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> stopped  = false;
+    std::barrier      start((std::ptrdiff_t)threads + 1);
+
+    auto work = [&](std::size_t thread) {
+        std::size_t failures   = 0;
+        std::size_t operations = 0;
+        bool        logged     = false;
+
+        start.arrive_and_wait();
+        while (timed ? !stopping.load(std::memory_order_relaxed)
+                     : operations < options.iterations)
+        {
+            if (token.stop_requested())
+            {
+                stopped.store(true, std::memory_order_relaxed);
+                break;
+            }
+
+            bool succeeded = true;
+            try
+            {
+                if constexpr (std::same_as<
+                    std::invoke_result_t<body_type &, std::size_t>, void>)
+                {
+                    std::invoke(body, thread);
+                }
+                else
+                {
+                    succeeded = (bool)std::invoke(body, thread);
+                }
+            }
+            catch (const std::exception &exception)
+            {
+                succeeded = false;
+                if (!logged)
+                {
+                    logln("Stress thread {} threw {}", thread,
+                        exception.what());
+                    logged = true;
+                }
+            }
+            catch (...)
+            {
+                succeeded = false;
+                if (!logged)
+                {
+                    logln("Stress thread {} threw an unknown exception",
+                        thread);
+                    logged = true;
+                }
+            }
+            failures += !succeeded;
+            operations++;
+        }
+
+        result.failures[thread]   = failures;
+        result.operations[thread] = operations;
+    };
+
+    {
+        std::vector<std::jthread> workers = {};
+        workers.reserve(threads);
+        for (std::size_t thread = 0; thread < threads; thread++)
+        {
+            workers.emplace_back(work, thread);
+        }
+
+        start.arrive_and_wait();
+        auto wall_start = std::chrono::steady_clock::now();
+        if (timed)
+        {
+            std::mutex                  mutex;
+            std::condition_variable_any condition;
+            std::unique_lock            lock(mutex);
+            condition.wait_for(lock, token, options.duration,
+                [] { return false; });
+            if (token.stop_requested())
+            {
+                stopped.store(true, std::memory_order_relaxed);
+            }
+            stopping.store(true, std::memory_order_relaxed);
+        }
+
+        for (auto &worker : workers) worker.join();
+        result.wall_time = std::chrono::steady_clock::now() - wall_start;
+    }
+    if (stopped) current_test_cancelled = true;
+    return result;
+}
+
+/**
+ *  @brief  Log the operations per second and failures of a stress test.
+ *
+ *  @param  name    Name of the stress test.
+ *  @param  result  Result.
+ */
+inline auto log_stress_result(std::string_view name, const stress_result &result)
+{
+    logln("{}: {} operations on {} threads in {:.3f} ms, {}, {} failures",
+        name, result.total_operations(), result.operations.size(),
+        to_milliseconds(result.wall_time),
+        format_rate(result.operations_per_second(), "ops"),
+        result.total_failures());
+    for (std::size_t thread = 0; thread < result.failures.size(); thread++)
+    {
+        if (result.failures[thread] == 0) continue;
+        logln("  Thread {}: {} of {} operations failed", thread,
+            result.failures[thread], result.operations[thread]);
+    }
+}
 
-    logln("Failed tests:");
-    for (auto &failed_test : failed_tests)
+#ifndef CT_ASSERT_STRESS
+/**
+ *  @brief  Run a stress test, arguments as @c run_stress , log its result
+ *          and count its failures as errors.
+ */
+#define CT_ASSERT_STRESS(name, ...)                                       \
+if (auto ct_stress = run_stress(__VA_ARGS__); true)                      \
+{                                                                         \
+    log_stress_result(name, ct_stress);                                   \
+    add_errors(CT_ERRORS, ct_stress.total_failures());                    \
+}                                                                         \
+do {} while (false)
+#endif // ifndef CT_ASSERT_STRESS
+
+/**
+ *  @brief  Read-only memory map of a file, or its contents read into memory
+ *          on non-POSIX systems.
+ */
+struct mapped_file {
+
+    /**
+     *  @brief  Start of the contents, null if empty.
+     */
+    const std::byte *data = nullptr;
+
+    /**
+     *  @brief  Size of the contents in bytes.
+     */
+    std::size_t size = 0;
+
+    /**
+     *  @brief  Contents read into memory where files cannot be mapped.
+     */
+    std::vector<std::byte> buffer;
+
+    /**
+     *  @brief  Map a file.
+     *
+     *  @param  path  Path to the file.
+     *  @throws std::system_error  If the file cannot be opened or mapped.
+     */
+    explicit mapped_file(const std::string &path);
+
+    mapped_file(const mapped_file &) = delete;
+    auto operator=(const mapped_file &) -> mapped_file & = delete;
+
+    ~mapped_file();
+
+    /**
+     *  @brief   Get the contents as bytes.
+     *  @return  The contents.
+     */
+    [[nodiscard]] inline auto bytes() const
     {
-        logln("  {}: {} errors", failed_test.first->title, failed_test.second);
+        return std::span<const std::byte>(data, size);
+    }
+
+    /**
+     *  @brief   Get the contents as text.
+     *  @return  The contents.
+     */
+    [[nodiscard]] inline auto text() const
+    {
+        return std::string_view((const char *)data, size);
+    }
+};
+
+/**
+ *  @brief  Rows made by a function of the row index.
+ *
+ *  @tparam  generate_type  Function of the row index returning the row.
+ */
+template<std::invocable<std::size_t> generate_type>
+struct generated_rows {
+
+    /**
+     *  @brief  Number of rows.
+     */
+    std::size_t count = 0;
+
+    /**
+     *  @brief  Function returning the row for an index.
+     */
+    generate_type generate;
+
+    /**
+     *  @brief  Number of rows in a chunk.
+     */
+    std::size_t chunk_size = 1024;
+
+    /**
+     *  @brief   Get the number of chunks.
+     *  @return  Number of chunks.
+     */
+    [[nodiscard]] inline auto chunk_count() const
+    {
+        return (count + chunk_size - 1) / chunk_size;
+    }
+
+    /**
+     *  @brief   Make and visit the rows of a chunk in order.
+     *
+     *  @param   chunk  Index of the chunk.
+     *  @param   visit  Called with each row, return false to stop.
+     *  @return  Number of rows of the chunk.
+     */
+    template<typename visit_type>
+    inline auto for_each_row(std::size_t chunk, visit_type &&visit) const
+    {
+        auto begin = chunk * chunk_size;
+        auto end   = std::min(begin + chunk_size, count);
+        for (auto index = begin; index < end; index++)
+        {
+            if (!visit(std::invoke(generate, index))) break;
+        }
+        return end - begin;
+    }
+};
+
+/**
+ *  @brief  Rows of fixed-size records of a mapped file.
+ *
+ *  @tparam  record_type  Type of a record, stored as is in the file.
+ */
+template<typename record_type>
+    requires std::is_trivially_copyable_v<record_type>
+struct file_records {
+
+    /**
+     *  @brief  Mapped file, kept alive while the rows are used.
+     */
+    const mapped_file *file = nullptr;
+
+    /**
+     *  @brief  Number of records in a chunk.
+     */
+    std::size_t chunk_size = 4096;
+
+    /**
+     *  @brief   Get the number of records.  A partial record at the end of
+     *           the file is ignored.
+     *  @return  Number of records.
+     */
+    [[nodiscard]] inline auto count() const
+    {
+        return file->size / sizeof(record_type);
+    }
+
+    /**
+     *  @brief   Get the number of chunks.
+     *  @return  Number of chunks.
+     */
+    [[nodiscard]] inline auto chunk_count() const
+    {
+        return (count() + chunk_size - 1) / chunk_size;
+    }
+
+    /**
+     *  @brief   Visit the records of a chunk in order.
+     *
+     *  @param   chunk  Index of the chunk.
+     *  @param   visit  Called with each record, return false to stop.
+     *  @return  Number of records of the chunk.
+     */
+    template<typename visit_type>
+    inline auto for_each_row(std::size_t chunk, visit_type &&visit) const
+    {
+        auto begin = chunk * chunk_size;
+        auto end   = std::min(begin + chunk_size, count());
+        for (auto index = begin; index < end; index++)
+        {
+            // Copied out, as the records may not be aligned in the file
+            record_type record;
+            std::memcpy(&record, file->data + index * sizeof(record_type),
+                sizeof(record_type));
+            if (!visit(record)) break;
+        }
+        return end - begin;
+    }
+};
+
+/**
+ *  @brief  Rows of the lines of a mapped text file, without their line
+ *          ending ("\n" or "\r\n").
+ *
+ *  The file is split into chunks of bytes, and each line belongs to the
+ *  chunk it starts in, so the lines are never indexed up front.
+ */
+struct file_lines {
+
+    /**
+     *  @brief  Mapped file, kept alive while the rows are used.
+     */
+    const mapped_file *file = nullptr;
+
+    /**
+     *  @brief  Number of bytes in a chunk.
+     */
+    std::size_t chunk_size = 1024 * 1024;
+
+    /**
+     *  @brief   Get the number of chunks.
+     *  @return  Number of chunks.
+     */
+    [[nodiscard]] inline auto chunk_count() const
+    {
+        return (file->size + chunk_size - 1) / chunk_size;
+    }
+
+    /**
+     *  @brief   Visit the lines starting in a chunk in order.
+     *
+     *  @param   chunk  Index of the chunk.
+     *  @param   visit  Called with each line, return false to stop.
+     *  @return  Number of lines starting in the chunk.
+     */
+    template<typename visit_type>
+    inline auto for_each_row(std::size_t chunk, visit_type &&visit) const
+    {
+        auto text  = file->text();
+        auto begin = chunk * chunk_size;
+        auto end   = std::min(begin + chunk_size, text.size());
+
+        // A line starts in this chunk if it follows a line ending that is
+        // at or after the last byte of the previous chunk
+        if (begin != 0)
+        {
+            auto ending = text.find('\n', begin - 1);
+            begin = ending == std::string_view::npos ? text.size()
+                                                     : ending + 1;
+        }
+
+        std::size_t lines   = 0;
+        bool        visited = true;
+        for (auto start = begin; start < end; lines++)
+        {
+            auto ending = text.find('\n', start);
+            if (ending == std::string_view::npos) ending = text.size();
+
+            auto line = text.substr(start, ending - start);
+            if (line.ends_with('\r')) line.remove_suffix(1);
+            if (visited) visited = visit(line);
+            start = ending + 1;
+        }
+        return lines;
+    }
+};
+
+/**
+ *  @brief  Source of rows of a parameterized test, visited in chunks that
+ *          can be checked in parallel.
+ */
+template<typename source_type>
+concept row_source = requires (const source_type &source) {
+    { source.chunk_count() } -> std::convertible_to<std::size_t>;
+};
+
+/**
+ *  @brief  Options of a parameterized test.
+ */
+struct rows_options {
+
+    /**
+     *  @brief  Number of workers, 0 to use hardware concurrency, or one
+     *          worker for a test run by a pool (see @c nested_workers ).
+     */
+    std::size_t workers = 0;
+
+    /**
+     *  @brief  Maximum number of failed rows to log, 0 for no limit.
+     */
+    std::size_t report_limit = mismatch_report_limit;
+};
+
+/**
+ *  @brief  Failed row of a parameterized test.
+ */
+struct row_failure {
+
+    /**
+     *  @brief  Index of the row.
+     */
+    std::size_t row = 0;
+
+    /**
+     *  @brief  How the row failed.
+     */
+    std::string message;
+};
+
+/**
+ *  @brief  Result of a parameterized test.
+ */
+struct rows_result {
+
+    /**
+     *  @brief  Number of rows checked.
+     */
+    std::size_t rows = 0;
+
+    /**
+     *  @brief  Number of failed rows.
+     */
+    std::size_t failed = 0;
+
+    /**
+     *  @brief  The first failed rows, up to @c rows_options::report_limit ,
+     *          in order of their index.
+     */
+    std::vector<row_failure> failures;
+};
+
+/**
+ *  @brief   Check a row with the body of a parameterized test.
+ *
+ *  @param   body  Body, called with the row.  Returns nothing, a bool that
+ *                 is true if the row passed, or an errors counter.
+ *  @param   row   Row.
+ *  @return  Nothing if the row passed, otherwise how it failed.
+ */
+template<typename body_type, typename row_type>
+[[nodiscard]] inline auto evaluate_row(
+    const body_type &body,
+    const row_type  &row
+) -> std::optional<std::string>
+{
+    try
+    {
+        using result_type = std::invoke_result_t<const body_type &,
+            const row_type &>;
+        if constexpr (std::same_as<result_type, void>)
+        {
+            std::invoke(body, row);
+        }
+        else if constexpr (std::same_as<result_type, bool>)
+        {
+            if (!std::invoke(body, row)) return "returned false";
+        }
+        else
+        {
+            if (CT_HAS_ERRORS(std::invoke(body, row))) return "had errors";
+        }
+        return std::nullopt;
+    }
+    catch (const std::exception &exception)
+    {
+        return std::format("threw {}", exception.what());
+    }
+    catch (...)
+    {
+        return "threw an unknown exception";
     }
 }
 
 /**
- *  @brief   Get sum of number of errors in all failed tests.
+ *  @brief   Check every row of a source with one body, streaming the rows
+ *           without storing them.
  *
- *  @param   failed_tests  Failed test results.
- *  @return  The number of total errors.
+ *  The chunks of the source are checked on a work-stealing pool, so
+ *  @p body must be thread-safe.  The index of a row is its position in the
+ *  source, found after the chunks are checked, so the reported failures do
+ *  not depend on the number of workers.  The failed rows are logged by
+ *  index.  Stops early once the run of the test is stopped, see
+ *  @c current_stop_token .
+ *
+ *  @param   name     Name of the parameterized test.
+ *  @param   source   Source of the rows, such as @c generated_rows ,
+ *                    @c file_records or @c file_lines .
+ *  @param   body     Body, as @c evaluate_row .
+ *  @param   options  Options.
+ *  @return  The result.
  */
-[[nodiscard]] inline constexpr auto sum_failed_tests_errors(
-    const std::vector<std::pair<const test_case *,
-        CT_ERRORS_TYPE>> &failed_tests
-)
+template<row_source source_type, typename body_type>
+inline auto check_rows(
+    std::string_view    name,
+    const source_type  &source,
+    const body_type    &body,
+    const rows_options &options = {}
+) -> rows_result
 {
-    CT_ERRORS_TYPE errors(CT_ERRORS_PARAMS);
-    std::ranges::for_each(failed_tests, [&](const auto &failed_test) {
-        CT_ADD_TO_ERRORS(errors, failed_test.second);
+    struct chunk_result {
+        std::size_t              rows   = 0;
+        std::size_t              failed = 0;
+        std::vector<row_failure> failures;
+    };
+
+    // Failures are kept by their index in the chunk until the chunks before
+    // are counted, and only the first few of each chunk can be reported
+    std::vector<chunk_result> chunks(source.chunk_count());
+    auto              token   = current_stop_token;
+    std::atomic<bool> stopped = false;
+    run_work_stealing(chunks.size(), nested_workers(options.workers),
+        [&](std::size_t chunk) {
+        if (token.stop_requested())
+        {
+            stopped.store(true, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto       &result = chunks[chunk];
+        std::size_t index  = 0;
+        result.rows = source.for_each_row(chunk, [&](const auto &row) {
+            if (auto failure = evaluate_row(body, row))
+            {
+                if (options.report_limit == 0
+                 || result.failures.size() < options.report_limit)
+                {
+                    result.failures.emplace_back(index, std::move(*failure));
+                }
+                result.failed++;
+            }
+            index++;
+            if (!token.stop_requested()) return true;
+            stopped.store(true, std::memory_order_relaxed);
+            return false;
+        });
+        return true;
     });
-    return errors;
+    if (stopped) current_test_cancelled = true;
+
+    rows_result result = {};
+    for (auto &chunk : chunks)
+    {
+        for (auto &failure : chunk.failures)
+        {
+            if (options.report_limit != 0
+             && result.failures.size() >= options.report_limit)
+            {
+                break;
+            }
+            failure.row += result.rows;
+            result.failures.emplace_back(std::move(failure));
+        }
+        result.rows   += chunk.rows;
+        result.failed += chunk.failed;
+    }
+
+    for (auto &failure : result.failures)
+    {
+        logln("{}: row {} {}", name, failure.row, failure.message);
+    }
+    if (result.failed != 0)
+    {
+        logln("{}: {} of {} rows failed", name, result.failed, result.rows);
+    }
+    return result;
+}
+
+#ifndef CT_ASSERT_ROWS
+/**
+ *  @brief  Assert that every row passes, arguments as @c check_rows .  Each
+ *          failed row counts as an error.
+ */
+#define CT_ASSERT_ROWS(name, ...)                                         \
+add_errors(CT_ERRORS, check_rows(name, __VA_ARGS__).failed)
+#endif // ifndef CT_ASSERT_ROWS
+
+/**
+ *  @brief  Write the actual values of snapshot assertions to their golden
+ *          files instead of comparing them.  Also enabled by setting the
+ *          @c CONFER_UPDATE_SNAPSHOTS environment variable to a non-zero
+ *          number.
+ */
+inline bool update_snapshots = false;
+
+/**
+ *  @brief  Number of bytes shown before and after the first difference of a
+ *          snapshot.
+ */
+inline std::size_t snapshot_context_size = 16;
+
+/**
+ *  @brief  Result of a snapshot assertion.
+ */
+struct snapshot_result {
+
+    /**
+     *  @brief  True if the value matched the golden file or updated it.
+     */
+    bool passed = true;
+
+    /**
+     *  @brief  True if the golden file was written.
+     */
+    bool updated = false;
+
+    /**
+     *  @brief  Offset of the first differing byte, if any.  Equals the size
+     *          of the shorter one if one is a prefix of the other.
+     */
+    std::optional<std::size_t> first_difference;
+};
+
+/**
+ *  @brief   Get the bytes of a value of a snapshot assertion.
+ *
+ *  @param   value  Text, or contiguous range of trivially copyable elements.
+ *  @return  The bytes of the value.
+ */
+template<typename value_type>
+[[nodiscard]] inline auto snapshot_bytes(const value_type &value)
+-> std::span<const std::byte>
+{
+    if constexpr (std::convertible_to<const value_type &, std::string_view>)
+    {
+        return std::as_bytes(std::span(std::string_view(value)));
+    }
+    else
+    {
+        static_assert(std::ranges::contiguous_range<const value_type>
+                   && std::is_trivially_copyable_v<
+                          std::ranges::range_value_t<const value_type>>,
+            "Snapshot value must be text or a contiguous range of trivially "
+            "copyable elements");
+        return std::as_bytes(std::span(std::ranges::data(value),
+            std::ranges::size(value)));
+    }
 }
+
+/**
+ *  @brief   Compare a value with a golden file, or write it to the file in
+ *           update mode.
+ *
+ *  The golden file is memory-mapped and compared in chunks, and only the
+ *  first differing chunk is compared byte by byte.  The first difference is
+ *  logged with @c snapshot_context_size bytes around it.  In update mode,
+ *  the file is written to a temporary file that replaces it, and left alone
+ *  if it is already equal.  See @c update_snapshots .
+ *
+ *  @param   actual  Bytes of the value.
+ *  @param   path    Path to the golden file.
+ *  @return  The result.
+ */
+auto check_snapshot(
+    std::span<const std::byte> actual,
+    const std::string         &path
+) -> snapshot_result;
+
+#ifndef CT_ASSERT_SNAPSHOT
+/**
+ *  @brief  Assert that a value matches a golden file, see
+ *          @c check_snapshot .
+ */
+#define CT_ASSERT_SNAPSHOT(value, path)                                    \
+if (!check_snapshot(snapshot_bytes(value), path).passed) [[unlikely]]     \
+{                                                                          \
+    CT_INCREMENT_ERRORS(CT_ERRORS);                                        \
+}                                                                          \
+do {} while (false)
+#endif // ifndef CT_ASSERT_SNAPSHOT
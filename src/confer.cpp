@@ -41,6 +41,2776 @@
 
 #include "confer.hpp" // IWYU pragma: keep
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <coroutine>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <optional>
+#include <ostream>
+#include <regex>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
-std::ofstream log_file;
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif // if defined(__unix__) || defined(__APPLE__)
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif // ifdef __linux__
+
+log_stream log_file;
+
+/**
+ *  @brief  A queued log message, allocated together with its text so that
+ *          queueing a message costs a single allocation.
+ */
+struct log_message {
+
+    /**
+     *  @brief  Stream to write to, null for a wake-up sentinel.
+     */
+    std::ostream *stream = nullptr;
+
+    /**
+     *  @brief  Size of the formatted text that follows the message.
+     */
+    std::size_t size = 0;
+
+    /**
+     *  @brief  Message pushed before this one.
+     */
+    log_message *next = nullptr;
+
+    /**
+     *  @brief   Allocate a message with a copy of the text.
+     *
+     *  @param   stream  Stream to write to, null for a wake-up sentinel.
+     *  @param   text    Formatted text.
+     *  @return  The message, to be freed with @c destroy .
+     */
+    [[nodiscard]] static inline auto create(
+        std::ostream    *stream,
+        std::string_view text
+    ) -> log_message *
+    {
+        void *memory  = ::operator new(sizeof(log_message) + text.size());
+        auto *message = ::new (memory) log_message {
+            .stream = stream, .size = text.size()
+        };
+        std::ranges::copy(text, static_cast<char *>(memory)
+            + sizeof(log_message));
+        return message;
+    }
+
+    /**
+     *  @brief  Free a message allocated by @c create .
+     *  @param  message  The message.
+     */
+    static inline auto destroy(log_message *message) noexcept -> void
+    {
+        message->~log_message();
+        ::operator delete(static_cast<void *>(message));
+    }
+
+    /**
+     *  @brief   Get the formatted text.
+     *  @return  The text.
+     */
+    [[nodiscard]] inline auto text() const -> std::string_view
+    {
+        return { reinterpret_cast<const char *>(this) + sizeof(log_message),
+            size };
+    }
+};
+
+/**
+ *  @brief  Background writer for log messages.
+ *
+ *  Producers push onto a lock-free stack.  The writer takes the whole stack
+ *  at once, restores the order and writes consecutive messages to the same
+ *  stream with a single write, so a burst of messages costs one write and
+ *  one flush per stream instead of one per message.
+ */
+struct log_writer {
+
+    /**
+     *  @brief  Most recently pushed message.
+     */
+    std::atomic<log_message *> head = nullptr;
+
+    /**
+     *  @brief  True while the writer thread accepts messages.
+     */
+    std::atomic<bool> running = false;
+
+    /**
+     *  @brief  True once the writer thread was asked to stop.
+     */
+    std::atomic<bool> stopping = false;
+
+    /**
+     *  @brief  Serializes taking and writing batches, so that batches are
+     *          written in the order they were taken.
+     */
+    std::mutex write_mutex;
+
+    /**
+     *  @brief  Starts the writer thread once.
+     */
+    std::once_flag start_flag;
+
+    /**
+     *  @brief  The writer thread.
+     */
+    std::thread thread;
+
+    /**
+     *  @brief  True in a forked worker process, which does not have the
+     *          writer thread of its parent.
+     */
+    bool forked = false;
+
+    /**
+     *  @brief  Stop the writer thread and write what is left.
+     */
+    inline ~log_writer()
+    {
+        if (!thread.joinable() || forked) return;
+        running.store(false);
+        stopping.store(true);
+        push(log_message::create(nullptr, {}));
+        // The writer may already be waiting, it needs to be woken up
+        head.notify_one();
+        thread.join();
+        flush();
+    }
+
+    /**
+     *  @brief   Push a message.
+     *  @return  True if the queue was empty.
+     */
+    inline auto push(log_message *message) -> bool
+    {
+        message->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(message->next, message,
+            std::memory_order_release, std::memory_order_relaxed))
+        {}
+        return message->next == nullptr;
+    }
+
+    /**
+     *  @brief   Take every pushed message.
+     *  @return  Messages in the order they were pushed.
+     */
+    [[nodiscard]] inline auto take() -> log_message *
+    {
+        log_message *reversed = head.exchange(nullptr,
+            std::memory_order_acquire);
+        log_message *ordered  = nullptr;
+        while (reversed)
+        {
+            log_message *next = reversed->next;
+            reversed->next = ordered;
+            ordered        = reversed;
+            reversed       = next;
+        }
+        return ordered;
+    }
+
+    /**
+     *  @brief  Write and free messages in order.
+     *  @param  messages  First message to write.
+     */
+    static inline auto write(log_message *messages) -> void
+    {
+        std::string   batch  = {};
+        std::ostream *stream = nullptr;
+        std::vector<std::ostream *> written = {};
+
+        auto write_batch = [&]() {
+            if (!stream || batch.empty()) return;
+            stream->write(batch.data(), (std::streamsize)batch.size());
+            if (std::ranges::find(written, stream) == written.end())
+            {
+                written.emplace_back(stream);
+            }
+            batch.clear();
+        };
+
+        while (messages)
+        {
+            if (messages->stream != stream)
+            {
+                write_batch();
+                stream = messages->stream;
+            }
+            batch += messages->text();
+
+            log_message *next = messages->next;
+            log_message::destroy(messages);
+            messages = next;
+        }
+        write_batch();
+
+        for (auto &stream : written) stream->flush();
+    }
+
+    /**
+     *  @brief  Write every pushed message on the calling thread.
+     */
+    inline auto flush() -> void
+    {
+        std::scoped_lock lock(write_mutex);
+        write(take());
+    }
+
+    /**
+     *  @brief  Wait for messages and write them until stopped.
+     */
+    inline auto work() -> void
+    {
+        while (!stopping.load())
+        {
+            head.wait(nullptr);
+            flush();
+        }
+    }
+
+    /**
+     *  @brief  Start the writer thread and the crash handlers.
+     */
+    inline auto start() -> void
+    {
+        std::call_once(start_flag, [&]() {
+            if (stopping.load()) return;
+            thread = std::thread([&]() { work(); });
+            running.store(true);
+            install_crash_handlers();
+        });
+    }
+
+    /**
+     *  @brief  Flush the logs on @c std::terminate and on crash signals
+     *          which have no handler yet.
+     */
+    static auto install_crash_handlers() -> void;
+};
+
+/**
+ *  @brief  The one log writer.
+ */
+static log_writer writer;
+
+/**
+ *  @brief  Pipe that logs are sent to instead of being written, used in
+ *          worker processes, -1 if none.
+ */
+static int log_capture_fd = -1;
+
+/**
+ *  @brief  Guards @c log_capture_fd and the messages sent through it.
+ */
+static std::mutex capture_mutex;
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ *  @brief  Send a log to the pipe of @c log_capture_fd , with
+ *          @c capture_mutex held.
+ *
+ *  @param  text  Log.
+ */
+static auto send_captured_log(std::string_view text) -> void;
+#endif // if defined(__unix__) || defined(__APPLE__)
+
+/**
+ *  @brief  Previous terminate handler.
+ */
+static std::terminate_handler previous_terminate_handler = nullptr;
+
+/**
+ *  @brief  Flush the logs and call the previous terminate handler.
+ */
+[[noreturn]] static auto log_terminate_handler() -> void
+{
+    log_flush();
+    if (previous_terminate_handler) previous_terminate_handler();
+    std::abort();
+}
+
+/**
+ *  @brief  Flush the logs as much as possible and re-raise the signal.
+ *
+ *  This is not async-signal-safe, it is a best effort attempt to not lose
+ *  the logs of the test that crashed.
+ *
+ *  @param  signal  Signal number.
+ */
+static auto log_signal_handler(int signal) -> void
+{
+    std::signal(signal, SIG_DFL);
+    if (writer.write_mutex.try_lock())
+    {
+        log_writer::write(writer.take());
+        writer.write_mutex.unlock();
+    }
+    std::raise(signal);
+}
+
+auto log_writer::install_crash_handlers() -> void
+{
+    previous_terminate_handler = std::set_terminate(log_terminate_handler);
+
+    for (int signal : { SIGSEGV, SIGABRT, SIGFPE, SIGILL })
+    {
+        auto previous = std::signal(signal, log_signal_handler);
+        if (previous != SIG_DFL) std::signal(signal, previous);
+    }
+}
+
+auto log_flush() -> void
+{
+    writer.flush();
+}
+
+auto log_submit(std::ostream &stream, std::string_view text) -> void
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (log_capture_fd >= 0)
+    {
+        std::scoped_lock lock(capture_mutex);
+        send_captured_log(text);
+        return;
+    }
+#endif // if defined(__unix__) || defined(__APPLE__)
+
+    writer.start();
+
+    // Write directly when the writer is unavailable (i.e., at exit)
+    if (!writer.running.load(std::memory_order_relaxed))
+    {
+        std::scoped_lock lock(writer.write_mutex);
+        stream.write(text.data(), (std::streamsize)text.size());
+        stream.flush();
+        return;
+    }
+
+    if (writer.push(log_message::create(&stream, text)))
+    {
+        writer.head.notify_one();
+    }
+}
+
+auto thread_cpu_time() -> std::chrono::nanoseconds
+{
+#if defined(__unix__) || defined(__APPLE__)
+    timespec time = {};
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+    {
+        return std::chrono::seconds(time.tv_sec)
+             + std::chrono::nanoseconds(time.tv_nsec);
+    }
+#endif // if defined(__unix__) || defined(__APPLE__)
+
+    // Process-wide, but better than nothing
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>((double)std::clock() / CLOCKS_PER_SEC));
+}
+
+#ifdef __linux__
+/**
+ *  @brief  Hardware counters of a thread, opened on first use.
+ */
+struct perf_session {
+
+    /**
+     *  @brief  Events to count, in the order of @c hardware_counters .
+     */
+    static constexpr std::uint64_t events[] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    /**
+     *  @brief  Counter descriptors, -1 if unavailable.
+     */
+    int descriptors[std::size(events)] = { -1, -1, -1, -1 };
+
+    /**
+     *  @brief  Process that opened the counters, 0 if not opened.
+     */
+    pid_t owner = 0;
+
+    ~perf_session() { close(); }
+
+    /**
+     *  @brief  Close the counters.
+     */
+    auto close() -> void
+    {
+        for (auto &descriptor : descriptors)
+        {
+            if (descriptor != -1) ::close(descriptor);
+            descriptor = -1;
+        }
+        owner = 0;
+    }
+
+    /**
+     *  @brief  Open the counters for the calling thread, unless opened.
+     */
+    auto open() -> void
+    {
+        // Counters inherited from the parent count the parent's thread
+        if (owner == ::getpid()) return;
+        close();
+        owner = ::getpid();
+
+        for (std::size_t i = 0; i < std::size(events); i++)
+        {
+            perf_event_attr attribute = {};
+            attribute.type           = PERF_TYPE_HARDWARE;
+            attribute.size           = sizeof(attribute);
+            attribute.config         = events[i];
+            attribute.disabled       = 1;
+            attribute.exclude_kernel = 1;
+            attribute.exclude_hv     = 1;
+            attribute.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED
+                                     | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            descriptors[i] = (int)::syscall(SYS_perf_event_open, &attribute,
+                0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        }
+    }
+
+    /**
+     *  @brief   Read a counter, scaled up if it was multiplexed.
+     *
+     *  @param   descriptor  Counter descriptor.
+     *  @return  Counter value, or nothing if unavailable.
+     */
+    static auto read(int descriptor) -> std::optional<std::uint64_t>
+    {
+        if (descriptor == -1) return std::nullopt;
+
+        std::uint64_t values[3] = {}; // Value, time enabled, time running
+        if (::read(descriptor, values, sizeof(values))
+            != (ssize_t)sizeof(values) || values[2] == 0)
+        {
+            return std::nullopt;
+        }
+        if (values[2] == values[1]) return values[0];
+        return (std::uint64_t)((double)values[0] * (double)values[1]
+                             / (double)values[2]);
+    }
+};
+
+/**
+ *  @brief  Hardware counters of the calling thread.
+ */
+static thread_local perf_session perf_counters;
+#endif // ifdef __linux__
+
+auto start_hardware_counters() -> void
+{
+#ifdef __linux__
+    perf_counters.open();
+    for (auto descriptor : perf_counters.descriptors)
+    {
+        if (descriptor == -1) continue;
+        ::ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif // ifdef __linux__
+}
+
+auto stop_hardware_counters() -> hardware_counters
+{
+#ifdef __linux__
+    auto &descriptors = perf_counters.descriptors;
+    for (auto descriptor : descriptors)
+    {
+        if (descriptor != -1) ::ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    return hardware_counters {
+        .cycles        = perf_session::read(descriptors[0]),
+        .instructions  = perf_session::read(descriptors[1]),
+        .branch_misses = perf_session::read(descriptors[2]),
+        .cache_misses  = perf_session::read(descriptors[3])
+    };
+#else // ifdef __linux__
+    return {};
+#endif // ifdef __linux__
+}
+
+auto vlogln(std::string_view format, std::format_args args) -> void
+{
+    untracked_allocations untracked = {};
+    log_buffer.clear();
+    std::vformat_to(std::back_inserter(log_buffer), format, args);
+    log_buffer.push_back('\n');
+
+    // Print to stdout if no file is specified
+    std::ostream &stream = log_file.is_open() ? log_file : std::cout;
+    log_submit(stream, log_buffer);
+}
+
+auto mismatch_report::start_range(std::size_t index) -> void
+{
+    end_range();
+    ranges++;
+    range_outer = outer;
+    range_begin = index;
+    range_end   = index + 1;
+    range_first.clear();
+}
+
+auto mismatch_report::end_range() -> void
+{
+    if (range_end == range_begin)
+    {
+        return;
+    }
+
+    if (logging())
+    {
+        untracked_allocations untracked = {};
+        auto nest = range_outer ? std::format("[{}]", *range_outer) : "";
+
+        if (range_end - range_begin == 1)
+        {
+            logln("Invalid element: {}{}[{}] != {}{}[{}] ({})", value_name,
+                nest, range_begin, expected_name, nest, range_begin,
+                range_first);
+        }
+        else
+        {
+            logln("Invalid elements: {}{}[{}..{}] != {}{}[{}..{}] "
+                "({} elements, first {})", value_name, nest, range_begin,
+                range_end - 1, expected_name, nest, range_begin,
+                range_end - 1, range_end - range_begin, range_first);
+        }
+    }
+
+    range_begin = range_end;
+}
+
+auto mismatch_report::finish() -> std::size_t
+{
+    end_range();
+
+    if (ranges > 1)
+    {
+        auto hidden = limit != 0 && ranges > limit ? ranges - limit : 0;
+        logln("Invalid elements: {} != {}: {} mismatched elements in {} "
+            "ranges, {} not shown", value_name, expected_name, mismatches,
+            ranges, hidden);
+    }
+
+    return mismatches;
+}
+
+auto log_approx_mismatch(
+    std::string_view       value_name,
+    std::string_view       expected_name,
+    struct tolerance       tolerance,
+    const approx_mismatch &mismatch
+) -> void
+{
+    logln("Not approximately equal: {} != {} ({} of {} elements out of {} "
+        "tolerance {}, worst {}[{}] = {} vs {}[{}] = {}, error {})",
+        value_name, expected_name, mismatch.count, mismatch.size,
+        to_string(tolerance.mode), tolerance.value, value_name,
+        mismatch.index, mismatch.value, expected_name, mismatch.index,
+        mismatch.expected, mismatch.error);
+}
+
+report_file::~report_file()
+{
+    if (stream.is_open())
+    {
+        stream.write(buffer.data(), (std::streamsize)buffer.size());
+    }
+}
+
+auto report_file::open(const std::string &path) -> void
+{
+    buffer.clear();
+    stream.open(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        throw std::runtime_error(std::format("Cannot open report file {}",
+            path));
+    }
+}
+
+auto report_file::write(std::string_view text) -> void
+{
+    buffer.append(text);
+    if (buffer.size() >= buffer_size)
+    {
+        flush();
+    }
+}
+
+auto report_file::flush() -> void
+{
+    stream.write(buffer.data(), (std::streamsize)buffer.size());
+    stream.flush();
+    buffer.clear();
+}
+
+auto report_file::close() -> void
+{
+    flush();
+    stream.close();
+}
+
+auto xml_escape(std::string_view text) -> std::string
+{
+    std::string escaped = {};
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            case '\'': escaped += "&apos;"; break;
+            case '\t': escaped += "&#9;"; break;
+            case '\n': escaped += "&#10;"; break;
+            case '\r': escaped += "&#13;"; break;
+            default:
+                // Control characters are not allowed in XML 1.0
+                if ((unsigned char)c < 0x20) escaped += "\uFFFD";
+                else escaped += c;
+                break;
+        }
+    }
+    return escaped;
+}
+
+auto json_escape(std::string_view text) -> std::string
+{
+    std::string escaped = {};
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\b': escaped += "\\b"; break;
+            case '\f': escaped += "\\f"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    std::format_to(std::back_inserter(escaped), "\\u{:04x}",
+                        (int)c);
+                }
+                else escaped += c;
+                break;
+        }
+    }
+    return escaped;
+}
+
+auto mann_whitney_p_value(
+    std::span<const double> current,
+    std::span<const double> baseline
+) -> double
+{
+    auto n1 = current.size();
+    auto n2 = baseline.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    // Rank both samples together, ties getting their mean rank
+    std::vector<std::pair<double, bool>> samples = {};
+    samples.reserve(n1 + n2);
+    for (auto value : current) samples.emplace_back(value, true);
+    for (auto value : baseline) samples.emplace_back(value, false);
+    std::ranges::sort(samples, {}, &std::pair<double, bool>::first);
+
+    double ranks = 0.0;
+    double ties  = 0.0;
+    for (std::size_t i = 0; i < samples.size();)
+    {
+        auto j = i;
+        std::size_t in_current = 0;
+        for (; j < samples.size() && samples[j].first == samples[i].first; j++)
+        {
+            in_current += samples[j].second;
+        }
+        auto count  = (double)(j - i);
+        ranks      += (double)in_current * ((double)(i + j + 1) / 2.0);
+        ties       += count * count * count - count;
+        i           = j;
+    }
+
+    // Number of pairs with the current sample greater, ties counting half
+    auto u = ranks - (double)(n1 * (n1 + 1)) / 2.0;
+
+    if (ties == 0.0 && n1 + n2 <= 64)
+    {
+        // Exact distribution of U: the largest of m + n samples is from
+        // current with probability m / (m + n), adding n to U
+        auto size = n1 * n2 + 1;
+        std::vector<std::vector<double>> previous(n2 + 1,
+            std::vector<double>(size));
+        std::vector<std::vector<double>> next = previous;
+        for (auto &distribution : previous) distribution[0] = 1.0;
+        for (std::size_t m = 1; m <= n1; m++)
+        {
+            next[0].assign(size, 0.0);
+            next[0][0] = 1.0;
+            for (std::size_t n = 1; n <= n2; n++)
+            {
+                auto from_current  = (double)m / (double)(m + n);
+                auto from_baseline = 1.0 - from_current;
+                for (std::size_t k = 0; k <= m * n; k++)
+                {
+                    next[n][k] = from_baseline * next[n - 1][k]
+                        + (k >= n ? from_current * previous[n][k - n] : 0.0);
+                }
+            }
+            std::swap(previous, next);
+        }
+
+        double p = 0.0;
+        for (auto k = (std::size_t)u; k < size; k++) p += previous[n2][k];
+        return std::min(p, 1.0);
+    }
+
+    auto n        = (double)(n1 + n2);
+    auto mean     = (double)(n1 * n2) / 2.0;
+    auto variance = (double)(n1 * n2) / 12.0
+        * (n + 1.0 - ties / (n * (n - 1.0)));
+    if (variance <= 0.0) return 1.0;
+
+    auto z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::numbers::sqrt2);
+}
+
+auto median_of(std::span<const double> samples) -> double
+{
+    if (samples.empty()) return 0.0;
+
+    std::vector<double> sorted(samples.begin(), samples.end());
+    auto middle = sorted.begin() + (std::ptrdiff_t)(sorted.size() / 2);
+    std::ranges::nth_element(sorted, middle);
+    if (sorted.size() % 2 == 1) return *middle;
+    return (*middle + *std::ranges::max_element(sorted.begin(), middle)) / 2.0;
+}
+
+/**
+ *  @brief  Exclusive lock of a file through a lock file next to it, held
+ *          while alive.  Does nothing on non-POSIX systems.
+ */
+struct file_lock {
+
+    /**
+     *  @brief  Lock file descriptor, -1 if none.
+     */
+    int descriptor = -1;
+
+    /**
+     *  @brief  Wait for the lock of a file.
+     *
+     *  @param  path  Path to the file to lock.
+     *  @throws std::system_error  If the lock file cannot be locked.
+     */
+    explicit file_lock([[maybe_unused]] const std::string &path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        auto lock_path = path + ".lock";
+        descriptor = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+            0644);
+        if (descriptor < 0)
+        {
+            throw std::system_error(errno, std::generic_category(),
+                std::format("Cannot open lock file {}", lock_path));
+        }
+
+        while (::flock(descriptor, LOCK_EX) != 0)
+        {
+            if (errno == EINTR) continue;
+            auto code = errno;
+            ::close(descriptor);
+            throw std::system_error(code, std::generic_category(),
+                std::format("Cannot lock {}", lock_path));
+        }
+#endif // if defined(__unix__) || defined(__APPLE__)
+    }
+
+    file_lock(const file_lock &) = delete;
+    auto operator=(const file_lock &) -> file_lock & = delete;
+
+    ~file_lock()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (descriptor >= 0) ::close(descriptor);
+#endif // if defined(__unix__) || defined(__APPLE__)
+    }
+};
+
+/**
+ *  @brief   Escape a function name for a baseline file, so that it cannot
+ *           contain the tab that ends it or the newline that ends the line.
+ *
+ *  @param   name  Function name.
+ *  @return  Escaped function name.
+ */
+static auto escape_baseline_name(std::string_view name) -> std::string
+{
+    std::string escaped = {};
+    escaped.reserve(name.size());
+    for (auto character : name)
+    {
+        switch (character)
+        {
+            case '\\': escaped += "\\\\"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            default: escaped += character; break;
+        }
+    }
+    return escaped;
+}
+
+/**
+ *  @brief   Unescape a function name of a baseline file.
+ *
+ *  @param   escaped  Escaped function name.
+ *  @return  Function name, or nothing if an escape is invalid.
+ */
+static auto unescape_baseline_name(
+    std::string_view escaped
+) -> std::optional<std::string>
+{
+    std::string name = {};
+    name.reserve(escaped.size());
+    for (std::size_t i = 0; i < escaped.size(); i++)
+    {
+        if (escaped[i] != '\\')
+        {
+            name += escaped[i];
+            continue;
+        }
+        if (++i == escaped.size()) return std::nullopt;
+        switch (escaped[i])
+        {
+            case '\\': name += '\\'; break;
+            case 't': name += '\t'; break;
+            case 'n': name += '\n'; break;
+            case 'r': name += '\r'; break;
+            default: return std::nullopt;
+        }
+    }
+    return name;
+}
+
+auto performance_baseline::load(const std::string &path) -> void
+{
+    samples.clear();
+
+    std::ifstream file(path);
+    if (!file) return;
+
+    std::string line = {};
+    for (std::size_t number = 1; std::getline(file, line); number++)
+    {
+        // The function name is escaped and ends at a tab, so a comment is a
+        // line starting with '#' without a tab
+        auto tab = line.find('\t');
+        if (line.empty() || (line.front() == '#' && tab == line.npos))
+        {
+            continue;
+        }
+
+        std::optional<std::string> name = {};
+        if (tab != line.npos)
+        {
+            name = unescape_baseline_name(std::string_view(line).substr(0,
+                tab));
+        }
+        if (!name)
+        {
+            throw std::runtime_error(std::format("Malformed baseline file "
+                "{} at line {}", path, number));
+        }
+
+        std::istringstream fields(line.substr(tab + 1));
+        auto &values = samples[*name];
+        for (double value = 0.0; fields >> value;) values.emplace_back(value);
+        if (!fields.eof())
+        {
+            throw std::runtime_error(std::format("Malformed baseline file "
+                "{} at line {}", path, number));
+        }
+    }
+}
+
+auto performance_baseline::save(const std::string &path) const -> void
+{
+    // Write next to the file and rename over it, so that readers never see
+    // a partially written baseline
+    auto temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error(std::format("Cannot write baseline file "
+                "{}", temporary));
+        }
+
+        file << "# confer baseline: escaped function name, tab and samples\n";
+        for (auto &[name, values] : samples)
+        {
+            file << escape_baseline_name(name) << '\t';
+            for (std::size_t i = 0; i < values.size(); i++)
+            {
+                if (i != 0) file << ' ';
+                file << std::format("{}", values[i]);
+            }
+            file << '\n';
+        }
+        if (!file.flush())
+        {
+            throw std::runtime_error(std::format("Cannot write baseline file "
+                "{}", temporary));
+        }
+    }
+
+    std::error_code error = {};
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        throw std::runtime_error(std::format("Cannot replace baseline file {}:"
+            " {}", path, error.message()));
+    }
+}
+
+auto performance_baseline::record(
+    const std::string      &name,
+    std::span<const double> values,
+    std::size_t             window
+) -> void
+{
+    auto &kept = samples[name];
+    kept.insert(kept.end(), values.begin(), values.end());
+    if (kept.size() > window)
+    {
+        kept.erase(kept.begin(),
+            kept.begin() + (std::ptrdiff_t)(kept.size() - window));
+    }
+}
+
+/**
+ *  @brief   Get the number of baseline samples needed for
+ *           @c mann_whitney_p_value to find a slowdown significant, which
+ *           is when every current sample is slower than every baseline
+ *           sample.
+ *
+ *  @param   current       Number of current samples.
+ *  @param   significance  Largest p-value of a significant slowdown.
+ *  @return  Number of baseline samples.
+ */
+static auto minimum_baseline_samples(
+    std::size_t current,
+    double      significance
+) -> std::size_t
+{
+    constexpr std::size_t limit = 1'000'000;
+
+    // The smallest p-value is 1 / C(current + baseline, current)
+    double      orderings = 1.0;
+    std::size_t baseline  = 0;
+    while (1.0 / orderings >= significance && baseline < limit)
+    {
+        baseline++;
+        orderings = orderings * (double)(current + baseline)
+                  / (double)baseline;
+    }
+    return baseline;
+}
+
+auto regression_gate::begin() -> void
+{
+    if (!enabled()) return;
+
+    loaded.load(path);
+    recorded.clear();
+    underpowered     = 0;
+    required_samples = 0;
+}
+
+auto regression_gate::check(
+    const std::string      &name,
+    std::span<const double> values
+) -> std::optional<performance_regression>
+{
+    if (!enabled() || values.empty()) return std::nullopt;
+
+    if (update)
+    {
+        auto &kept = recorded[name];
+        kept.insert(kept.end(), values.begin(), values.end());
+        return std::nullopt;
+    }
+
+    auto found = loaded.samples.find(name);
+    if (found == loaded.samples.end() || found->second.empty())
+    {
+        return std::nullopt;
+    }
+
+    // Too few samples could never show a significant slowdown
+    auto needed = minimum_baseline_samples(values.size(), significance);
+    if (found->second.size() < needed)
+    {
+        underpowered++;
+        required_samples = std::max(required_samples, needed);
+        return std::nullopt;
+    }
+
+    performance_regression regression = {
+        .baseline_median = median_of(found->second),
+        .current_median  = median_of(values),
+    };
+    if (regression.current_median
+        <= regression.baseline_median * (1.0 + threshold))
+    {
+        return std::nullopt;
+    }
+
+    regression.p_value = mann_whitney_p_value(values, found->second);
+    if (regression.p_value >= significance) return std::nullopt;
+    return regression;
+}
+
+auto regression_gate::end() -> void
+{
+    if (!enabled()) return;
+
+    if (underpowered != 0)
+    {
+        logln("Regression gate {} skipped {} functions with fewer than the "
+            "{} baseline samples needed to detect a regression at "
+            "significance {}, add samples with update", path, underpowered,
+            required_samples, significance);
+    }
+    if (!update || recorded.empty()) return;
+
+    // Merge with what other writers saved since this run loaded the file
+    file_lock lock(path);
+    loaded.load(path);
+    for (auto &[name, values] : recorded)
+    {
+        loaded.record(name, values, window);
+    }
+    loaded.save(path);
+    recorded.clear();
+}
+
+auto async_executor::post(std::coroutine_handle<> handle) -> void
+{
+    {
+        std::scoped_lock lock(mutex);
+        ready.push_back(handle);
+    }
+    condition.notify_one();
+}
+
+/**
+ *  @brief   Order timers for a heap with the earliest first.
+ *
+ *  @param   a  Timer.
+ *  @param   b  Timer.
+ *  @return  True if @p a is later than @p b .
+ */
+static auto later_timer(
+    const std::pair<std::chrono::steady_clock::time_point,
+        std::coroutine_handle<>> &a,
+    const std::pair<std::chrono::steady_clock::time_point,
+        std::coroutine_handle<>> &b
+) -> bool
+{
+    return a.first > b.first;
+}
+
+auto async_executor::post_at(
+    std::chrono::steady_clock::time_point time,
+    std::coroutine_handle<>               handle
+) -> void
+{
+    {
+        std::scoped_lock lock(mutex);
+        timers.emplace_back(time, handle);
+        std::ranges::push_heap(timers, later_timer);
+    }
+    // The earliest timer may have changed, every waiting thread rechecks
+    condition.notify_all();
+}
+
+auto async_executor::job_started() -> void
+{
+    std::scoped_lock lock(mutex);
+    pending++;
+}
+
+auto async_executor::job_finished() -> void
+{
+    bool last = false;
+    {
+        std::scoped_lock lock(mutex);
+        last = --pending == 0;
+    }
+    if (last) condition.notify_all();
+}
+
+auto async_executor::run(std::size_t threads, std::stop_token token) -> void
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max<std::size_t>(threads, 1);
+
+    auto work = [&]() {
+        auto previous_executor = std::exchange(current_executor, this);
+        auto previous_token    = std::exchange(current_stop_token, token);
+
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            auto now = std::chrono::steady_clock::now();
+            while (!timers.empty() && timers.front().first <= now)
+            {
+                std::ranges::pop_heap(timers, later_timer);
+                ready.push_back(timers.back().second);
+                timers.pop_back();
+            }
+
+            if (!ready.empty())
+            {
+                auto handle = ready.front();
+                ready.pop_front();
+                lock.unlock();
+                handle.resume();
+                lock.lock();
+                continue;
+            }
+
+            if (pending == 0) break;
+            if (timers.empty()) condition.wait(lock);
+            else condition.wait_until(lock, timers.front().first);
+        }
+        lock.unlock();
+
+        current_stop_token = std::move(previous_token);
+        current_executor   = previous_executor;
+    };
+
+    std::vector<std::jthread> workers = {};
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; i++) workers.emplace_back(work);
+    work();
+}
+
+auto request_stop_at(
+    std::stop_source                      source,
+    std::chrono::steady_clock::time_point deadline
+) -> std::jthread
+{
+    return std::jthread([source, deadline](std::stop_token token) mutable {
+        std::mutex                  mutex;
+        std::condition_variable_any condition;
+        std::unique_lock            lock(mutex);
+        condition.wait_until(lock, token, deadline, [] { return false; });
+        if (!token.stop_requested()) source.request_stop();
+    });
+}
+
+auto executable_fingerprint() -> std::uint64_t
+{
+#ifdef __linux__
+    std::ifstream file("/proc/self/exe", std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Cannot read the executable to fingerprint "
+                                 "it");
+    }
+
+    std::vector<std::byte> buffer(1024 * 1024);
+    auto hash = hash_bytes({});
+    while (file.read((char *)buffer.data(), (std::streamsize)buffer.size())
+        || file.gcount() > 0)
+    {
+        hash = hash_bytes(std::span(buffer).first(
+            (std::size_t)file.gcount()), hash);
+    }
+    return hash;
+#else  // ifdef __linux__
+    throw std::runtime_error("Hashing the executable is only available on "
+                             "Linux, set result_cache::fingerprint");
+#endif // ifdef __linux__
+}
+
+/**
+ *  @brief  Magic number at the start of a result cache file.
+ */
+static constexpr char result_cache_magic[8] = {
+    'C', 'T', 'C', 'A', 'C', 'H', 'E', '1'
+};
+
+/**
+ *  @brief  Record of a passed test in a result cache file.
+ */
+struct result_cache_record {
+    std::uint64_t key  = 0;
+    std::int64_t  time = 0;
+};
+
+/**
+ *  @brief   Read a result cache file.
+ *
+ *  @param   path  Path to the file.
+ *  @return  Time each test passed by key, empty if the file does not exist
+ *           or is not a result cache.
+ */
+static auto read_result_cache(const std::string &path)
+-> std::unordered_map<std::uint64_t, std::int64_t>
+{
+    std::unordered_map<std::uint64_t, std::int64_t> passed = {};
+
+    std::error_code error = {};
+    auto size = std::filesystem::file_size(path, error);
+    if (error || size < sizeof(result_cache_magic)
+     || (size - sizeof(result_cache_magic)) % sizeof(result_cache_record))
+    {
+        return passed;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(result_cache_magic)] = {};
+    file.read(magic, sizeof(magic));
+    if (!file || !std::ranges::equal(magic, result_cache_magic))
+    {
+        return passed;
+    }
+
+    std::vector<result_cache_record> records(
+        (size - sizeof(result_cache_magic)) / sizeof(result_cache_record));
+    file.read((char *)records.data(),
+        (std::streamsize)(records.size() * sizeof(result_cache_record)));
+    if (!file) return passed;
+
+    passed.reserve(records.size());
+    for (auto &record : records) passed.emplace(record.key, record.time);
+    return passed;
+}
+
+auto result_cache::begin() -> void
+{
+    if (!enabled()) return;
+
+    if (fingerprint == 0) fingerprint = executable_fingerprint();
+    passed = read_result_cache(path);
+    changes.clear();
+}
+
+auto result_cache::contains(std::string_view function_name) const -> bool
+{
+    return passed.contains(key(function_name));
+}
+
+auto result_cache::record(std::string_view function_name, bool test_passed)
+-> void
+{
+    changes[key(function_name)] = test_passed;
+}
+
+auto result_cache::end() -> void
+{
+    if (!enabled() || changes.empty()) return;
+
+    auto now = (std::int64_t)std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Merge with what other writers saved since this run loaded the file
+    file_lock lock(path);
+    passed = read_result_cache(path);
+    for (auto &[changed, test_passed] : changes)
+    {
+        if (test_passed) passed[changed] = now;
+        else passed.erase(changed);
+    }
+    std::erase_if(passed, [&](auto &entry) {
+        return now - entry.second > max_age.count();
+    });
+
+    std::vector<result_cache_record> records = {};
+    records.reserve(passed.size());
+    for (auto &[passed_key, time] : passed)
+    {
+        records.push_back({ passed_key, time });
+    }
+
+    // Readers do not lock, so they must never see a partially written file
+    auto temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(result_cache_magic, sizeof(result_cache_magic));
+        file.write((const char *)records.data(),
+            (std::streamsize)(records.size() * sizeof(result_cache_record)));
+        if (!file.flush())
+        {
+            throw std::runtime_error(std::format("Cannot write result cache "
+                "file {}", temporary));
+        }
+    }
+
+    std::error_code error = {};
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        throw std::runtime_error(std::format("Cannot replace result cache "
+            "file {}: {}", path, error.message()));
+    }
+    changes.clear();
+}
+
+/**
+ *  @brief   Match a whole text with a glob pattern.
+ *
+ *  On a mismatch, backtracks only to the last @c * , which suffices as a
+ *  later @c * can match anything an earlier one could.
+ *
+ *  @param   pattern  Glob pattern.
+ *  @param   text     Text to match.
+ *  @return  True if the text matches.
+ */
+static auto glob_match(std::string_view pattern, std::string_view text)
+    -> bool
+{
+    std::size_t p = 0, t = 0;
+    std::size_t star = std::string_view::npos, star_text = 0;
+
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+        {
+            p++;
+            t++;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star      = p++;
+            star_text = t;
+        }
+        else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            t = ++star_text;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+/**
+ *  @brief  Compiled pattern of a filter.
+ */
+struct compiled_pattern {
+    std::string               text;
+    std::optional<std::regex> regex;
+
+    /**
+     *  @brief   Check if a text matches the pattern.
+     *
+     *  @param   subject  Text to match.
+     *  @return  True if the text matches.
+     */
+    [[nodiscard]] auto matches(std::string_view subject) const -> bool
+    {
+        if (regex)
+        {
+            return std::regex_search(subject.begin(), subject.end(), *regex);
+        }
+        return glob_match(text, subject);
+    }
+};
+
+struct compiled_filter {
+    std::vector<compiled_pattern> include;
+    std::vector<compiled_pattern> exclude;
+    std::vector<std::string>      include_tags;
+    std::vector<std::string>      exclude_tags;
+};
+
+/**
+ *  @brief   Compile the patterns.
+ *
+ *  @param   patterns  Patterns.
+ *  @param   syntax    Syntax of the patterns.
+ *  @return  Compiled patterns.
+ */
+static auto compile_patterns(
+    const std::vector<std::string> &patterns,
+    pattern_syntax                  syntax
+) -> std::vector<compiled_pattern>
+{
+    std::vector<compiled_pattern> compiled = {};
+    compiled.reserve(patterns.size());
+    for (auto &pattern : patterns)
+    {
+        auto &result = compiled.emplace_back(pattern);
+        if (syntax != pattern_syntax::regex) continue;
+
+        try
+        {
+            result.regex.emplace(pattern, std::regex::ECMAScript
+                | std::regex::optimize);
+        }
+        catch (const std::regex_error &error)
+        {
+            throw std::invalid_argument(std::format(
+                "Invalid filter pattern {}: {}", pattern, error.what()));
+        }
+    }
+    return compiled;
+}
+
+auto compile_filter(const test_filter &filter) -> test_matcher
+{
+    auto compiled = std::make_shared<compiled_filter>();
+    compiled->include      = compile_patterns(filter.include, filter.syntax);
+    compiled->exclude      = compile_patterns(filter.exclude, filter.syntax);
+    compiled->include_tags = filter.include_tags;
+    compiled->exclude_tags = filter.exclude_tags;
+    return test_matcher { std::move(compiled) };
+}
+
+auto test_matcher::matches(
+    std::string_view                title,
+    std::string_view                function_name,
+    const std::vector<std::string> &tags
+) const -> bool
+{
+    auto name_matches = [&](const compiled_pattern &pattern) {
+        return pattern.matches(title) || pattern.matches(function_name);
+    };
+    auto has_tag = [&](const std::string &tag) {
+        return std::ranges::find(tags, tag) != tags.end();
+    };
+
+    if (!compiled) return true;
+    auto &filter = *compiled;
+
+    if (!filter.include.empty()
+     && !std::ranges::any_of(filter.include, name_matches))
+    {
+        return false;
+    }
+    if (!filter.include_tags.empty()
+     && !std::ranges::any_of(filter.include_tags, has_tag))
+    {
+        return false;
+    }
+    return !std::ranges::any_of(filter.exclude, name_matches)
+        && !std::ranges::any_of(filter.exclude_tags, has_tag);
+}
+
+/**
+ *  @brief  Queue of task indices owned by a worker, stolen from by others.
+ */
+struct work_queue {
+
+    /**
+     *  @brief  Guards @c indices .
+     */
+    std::mutex mutex;
+
+    /**
+     *  @brief  Indices of tasks yet to run.
+     */
+    std::deque<std::size_t> indices;
+
+    /**
+     *  @brief   Take the next task of the owning worker.
+     *  @return  Index of the task, if any.
+     */
+    [[nodiscard]] inline auto pop() -> std::optional<std::size_t>
+    {
+        std::scoped_lock lock(mutex);
+        if (indices.empty()) return std::nullopt;
+        std::size_t index = indices.front();
+        indices.pop_front();
+        return index;
+    }
+
+    /**
+     *  @brief   Take a task from the other end for a thief worker.
+     *  @return  Index of the task, if any.
+     */
+    [[nodiscard]] inline auto steal() -> std::optional<std::size_t>
+    {
+        std::scoped_lock lock(mutex);
+        if (indices.empty()) return std::nullopt;
+        std::size_t index = indices.back();
+        indices.pop_back();
+        return index;
+    }
+};
+
+/**
+ *  @brief  What a worker of a watched pool is running.
+ */
+struct work_slot {
+
+    /**
+     *  @brief  Guards the slot.
+     */
+    std::mutex mutex;
+
+    /**
+     *  @brief  Index of the running task, if any.
+     */
+    std::optional<std::size_t> index = std::nullopt;
+
+    /**
+     *  @brief  When the running task times out.
+     */
+    std::chrono::steady_clock::time_point deadline = {};
+
+    /**
+     *  @brief  Incremented when the watchdog abandons the thread of this
+     *          slot, so that thread knows it is no longer the worker.
+     */
+    std::size_t generation = 0;
+};
+
+/**
+ *  @brief  Shared state of a work-stealing pool.
+ *
+ *  Threads abandoned by the watchdog keep it alive until the task they are
+ *  stuck in returns, long after @c run_work_stealing returned.
+ */
+struct work_pool {
+
+    /**
+     *  @brief  Task to run for an index.
+     */
+    std::function<bool (std::size_t)> task;
+
+    /**
+     *  @brief  Timeout of each task, empty if none.
+     */
+    std::vector<std::chrono::nanoseconds> timeouts;
+
+    /**
+     *  @brief  Queue of each worker.
+     */
+    std::vector<work_queue> queues;
+
+    /**
+     *  @brief  Slot of each worker, used if there are timeouts.
+     */
+    std::vector<work_slot> slots;
+
+    /**
+     *  @brief  True once the remaining tasks are cancelled.
+     */
+    std::atomic<bool> cancelled = false;
+
+    /**
+     *  @brief  Guards @c exception and @c live .
+     */
+    std::mutex mutex;
+
+    /**
+     *  @brief  Signalled when a worker ends.
+     */
+    std::condition_variable worker_ended;
+
+    /**
+     *  @brief  First exception thrown by a task.
+     */
+    std::exception_ptr exception = nullptr;
+
+    /**
+     *  @brief  Number of workers that have not ended yet, not counting
+     *          abandoned threads.
+     */
+    std::size_t live = 0;
+
+    /**
+     *  @brief   Take the next task for a worker, stealing if it has none.
+     *
+     *  @param   id  ID of the worker.
+     *  @return  Index of the task, if any.
+     */
+    [[nodiscard]] inline auto next(std::size_t id) -> std::optional<std::size_t>
+    {
+        std::optional<std::size_t> index = queues[id].pop();
+
+        // Tasks are never added, so nothing left anywhere means done
+        for (std::size_t i = 1; !index && i < queues.size(); i++)
+        {
+            index = queues[(id + i) % queues.size()].steal();
+        }
+        return index;
+    }
+
+    /**
+     *  @brief  Run a task, recording a thrown exception.
+     *  @param  index  Index of the task.
+     */
+    inline auto run(std::size_t index) -> void
+    {
+        try
+        {
+            if (!task(index)) cancelled.store(true, std::memory_order_relaxed);
+        }
+        catch (...)
+        {
+            std::scoped_lock lock(mutex);
+            if (!exception) exception = std::current_exception();
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ *  @brief  The slot of the calling thread if it is a worker of a watched
+ *          pool.
+ */
+struct current_work {
+
+    /**
+     *  @brief  The pool, kept alive while the thread runs.
+     */
+    std::shared_ptr<work_pool> pool = nullptr;
+
+    /**
+     *  @brief  ID of the worker.
+     */
+    std::size_t id = 0;
+
+    /**
+     *  @brief  Generation of the slot this thread was started with.
+     */
+    std::size_t generation = 0;
+};
+
+/**
+ *  @brief  The slot of the calling thread.
+ */
+static thread_local current_work current = {};
+
+/**
+ *  @brief  True on a thread that runs tasks of a pool, and in a worker
+ *          process.
+ */
+static thread_local bool worker_thread = false;
+
+auto on_worker() -> bool
+{
+    return worker_thread;
+}
+
+auto work_started() -> void
+{
+    if (!current.pool) return;
+
+    auto &slot = current.pool->slots[current.id];
+    std::scoped_lock lock(slot.mutex);
+    if (slot.generation != current.generation || !slot.index) return;
+
+    auto timeout  = current.pool->timeouts[*slot.index];
+    slot.deadline = timeout.count() != 0
+                  ? std::chrono::steady_clock::now() + timeout
+                  : std::chrono::steady_clock::time_point::max();
+}
+
+auto work_finished() -> bool
+{
+    if (!current.pool) return true;
+
+    auto &slot = current.pool->slots[current.id];
+    std::scoped_lock lock(slot.mutex);
+    if (slot.generation != current.generation) return false;
+    slot.index = std::nullopt;
+    return true;
+}
+
+/**
+ *  @brief  Run tasks as a worker of a watched pool until none are left, or
+ *          until the watchdog abandons this thread.
+ *
+ *  @param  pool        The pool.
+ *  @param  id          ID of the worker.
+ *  @param  generation  Generation of the slot.
+ */
+static auto watched_worker(
+    std::shared_ptr<work_pool> pool,
+    std::size_t                id,
+    std::size_t                generation
+) -> void
+{
+    current       = { pool, id, generation };
+    worker_thread = true;
+    auto &slot    = pool->slots[id];
+
+    while (!pool->cancelled.load(std::memory_order_relaxed))
+    {
+        std::optional<std::size_t> index = pool->next(id);
+        if (!index) break;
+
+        // Not timed until the task calls work_started
+        {
+            std::scoped_lock lock(slot.mutex);
+            if (slot.generation != generation) return;
+            slot.index    = index;
+            slot.deadline = std::chrono::steady_clock::time_point::max();
+        }
+
+        pool->run(*index);
+
+        // Abandoned while in the task, the task is reported already
+        if (!work_finished()) return;
+    }
+
+    std::scoped_lock slot_lock(slot.mutex);
+    if (slot.generation != generation) return;
+    std::scoped_lock lock(pool->mutex);
+    pool->live--;
+    pool->worker_ended.notify_all();
+}
+
+auto run_work_stealing(
+    std::size_t                                  count,
+    std::size_t                                  workers,
+    const std::function<bool (std::size_t)>     &task,
+    const std::vector<std::chrono::nanoseconds> &timeouts,
+    const std::function<bool (std::size_t)>     &timed_out
+) -> void
+{
+    if (count == 0) return;
+
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    workers = std::clamp<std::size_t>(workers, 1, count);
+
+    auto pool = std::make_shared<work_pool>(task, timeouts,
+        std::vector<work_queue>(workers));
+
+    // Hand out contiguous blocks so that neighboring tests stay on a worker
+    for (std::size_t i = 0; i < workers; i++)
+    {
+        std::size_t begin = count * i / workers;
+        std::size_t end   = count * (i + 1) / workers;
+        for (std::size_t index = begin; index < end; index++)
+        {
+            pool->queues[i].indices.push_back(index);
+        }
+    }
+
+    if (timeouts.empty())
+    {
+        auto worker = [&](std::size_t id) {
+            auto previous = std::exchange(worker_thread, true);
+            while (!pool->cancelled.load(std::memory_order_relaxed))
+            {
+                std::optional<std::size_t> index = pool->next(id);
+                if (!index) break;
+                pool->run(*index);
+            }
+            worker_thread = previous;
+        };
+
+        std::vector<std::jthread> threads = {};
+        threads.reserve(workers - 1);
+        for (std::size_t id = 1; id < workers; id++)
+        {
+            threads.emplace_back(worker, id);
+        }
+        worker(0);
+    }
+    else
+    {
+        // Every worker is a thread that can be abandoned, the calling thread
+        // is the watchdog
+        pool->slots = std::vector<work_slot>(workers);
+        pool->live  = workers;
+
+        std::vector<std::thread> threads = {};
+        threads.reserve(workers);
+        for (std::size_t id = 0; id < workers; id++)
+        {
+            threads.emplace_back(watched_worker, pool, id, 0);
+        }
+
+        // Check often enough to not overshoot the shortest timeout by much
+        auto shortest = std::ranges::min(timeouts, {},
+            [&](std::chrono::nanoseconds timeout) {
+            return timeout.count() != 0 ? timeout
+                                        : std::chrono::nanoseconds::max();
+        });
+        auto interval = std::clamp<std::chrono::nanoseconds>(shortest / 10,
+            std::chrono::milliseconds(1), std::chrono::milliseconds(100));
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(pool->mutex);
+                if (pool->worker_ended.wait_for(lock, interval, [&]() {
+                    return pool->live == 0;
+                }))
+                {
+                    break;
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            for (std::size_t id = 0; id < workers; id++)
+            {
+                auto                      &slot  = pool->slots[id];
+                std::optional<std::size_t> index = std::nullopt;
+                {
+                    std::scoped_lock lock(slot.mutex);
+                    if (!slot.index || now < slot.deadline) continue;
+
+                    // Leave the thread stuck in the task, and replace it
+                    index      = slot.index;
+                    slot.index = std::nullopt;
+                    slot.generation++;
+                    threads[id].detach();
+                    threads[id] = std::thread(watched_worker, pool, id,
+                        slot.generation);
+                }
+
+                try
+                {
+                    if (!timed_out(*index))
+                    {
+                        pool->cancelled.store(true, std::memory_order_relaxed);
+                    }
+                }
+                catch (...)
+                {
+                    std::scoped_lock lock(pool->mutex);
+                    if (!pool->exception)
+                    {
+                        pool->exception = std::current_exception();
+                    }
+                    pool->cancelled.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        for (auto &thread : threads) thread.join();
+    }
+
+    if (pool->exception) std::rethrow_exception(pool->exception);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ *  @brief   Write all bytes to a file descriptor.
+ *
+ *  @param   fd    File descriptor.
+ *  @param   data  Bytes to write.
+ *  @param   size  Number of bytes.
+ *  @return  False if the other end is gone.
+ */
+[[nodiscard]] static auto write_all(
+    int         fd,
+    const void *data,
+    std::size_t size
+) -> bool
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size  -= (std::size_t)written;
+    }
+    return true;
+}
+
+/**
+ *  @brief   Read exactly @p size bytes from a file descriptor.
+ *
+ *  @param   fd    File descriptor.
+ *  @param   data  Buffer to read into.
+ *  @param   size  Number of bytes.
+ *  @return  False if the other end is gone before all bytes arrived.
+ */
+[[nodiscard]] static auto read_all(
+    int         fd,
+    void       *data,
+    std::size_t size
+) -> bool
+{
+    char *bytes = static_cast<char *>(data);
+    while (size > 0)
+    {
+        ssize_t count = ::read(fd, bytes, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        bytes += count;
+        size  -= (std::size_t)count;
+    }
+    return true;
+}
+
+/**
+ *  @brief   Send a string prefixed with its size.
+ *
+ *  @param   fd    File descriptor.
+ *  @param   text  String to send.
+ *  @return  False if the other end is gone.
+ */
+[[nodiscard]] static auto write_string(int fd, std::string_view text) -> bool
+{
+    std::uint64_t size = text.size();
+    return write_all(fd, &size, sizeof(size))
+        && write_all(fd, text.data(), text.size());
+}
+
+/**
+ *  @brief  Kind of a message sent by a worker process.
+ */
+enum class pool_message : std::uint8_t {
+    log,   ///< Log of the running task, sent as it is logged.
+    result ///< Output and crash description of the finished task.
+};
+
+/**
+ *  @brief   Send the kind of a message from a worker process.
+ *
+ *  @param   fd    File descriptor.
+ *  @param   kind  Kind of the message.
+ *  @return  False if the other end is gone.
+ */
+[[nodiscard]] static auto write_message(int fd, pool_message kind) -> bool
+{
+    return write_all(fd, &kind, sizeof(kind));
+}
+
+static auto send_captured_log(std::string_view text) -> void
+{
+    // The parent being gone is noticed when the result is sent
+    if (write_message(log_capture_fd, pool_message::log))
+    {
+        (void)write_string(log_capture_fd, text);
+    }
+}
+
+/**
+ *  @brief   Receive a string prefixed with its size.
+ *
+ *  @param   fd    File descriptor.
+ *  @param   text  String to receive into.
+ *  @return  False if the other end is gone.
+ */
+[[nodiscard]] static auto read_string(int fd, std::string &text) -> bool
+{
+    std::uint64_t size = 0;
+    if (!read_all(fd, &size, sizeof(size))) return false;
+    text.resize(size);
+    return read_all(fd, text.data(), size);
+}
+
+/**
+ *  @brief   Describe how a worker process ended.
+ *
+ *  @param   status  Status from @c waitpid .
+ *  @return  Description of the status.
+ */
+[[nodiscard]] static auto describe_status(int status) -> std::string
+{
+    if (WIFSIGNALED(status))
+    {
+        int signal = WTERMSIG(status);
+        return std::format("killed by signal {} ({})", signal,
+            ::strsignal(signal));
+    }
+    if (WIFEXITED(status))
+    {
+        return std::format("exited with status {}", WEXITSTATUS(status));
+    }
+    return "ended unexpectedly";
+}
+
+/**
+ *  @brief  A forked worker process.
+ */
+struct pool_worker {
+
+    /**
+     *  @brief  Process ID, -1 if not running.
+     */
+    pid_t pid = -1;
+
+    /**
+     *  @brief  Write end of the pipe sending task indices.
+     */
+    int task_fd = -1;
+
+    /**
+     *  @brief  Read end of the pipe receiving results.
+     */
+    int result_fd = -1;
+
+    /**
+     *  @brief  Index of the running task.
+     */
+    std::optional<std::size_t> index = std::nullopt;
+
+    /**
+     *  @brief  When the running task times out.
+     */
+    std::chrono::steady_clock::time_point deadline = {};
+
+    /**
+     *  @brief  Logs of the running task received so far.
+     */
+    std::string log;
+};
+
+/**
+ *  @brief  Pool of forked worker processes.
+ */
+struct process_pool {
+
+    /**
+     *  @brief  All the workers.
+     */
+    std::vector<pool_worker> workers;
+
+    /**
+     *  @brief  Task to run in a worker.
+     */
+    const std::function<std::string (std::size_t)> *task = nullptr;
+
+    /**
+     *  @brief  Kill running workers and reap all of them.
+     */
+    inline ~process_pool()
+    {
+        for (auto &worker : workers)
+        {
+            if (worker.index && worker.pid > 0) ::kill(worker.pid, SIGKILL);
+            stop(worker);
+        }
+    }
+
+    /**
+     *  @brief  Loop of a worker process: run tasks until the pipe closes.
+     *
+     *  @param  task_fd    Read end of the pipe receiving task indices.
+     *  @param  result_fd  Write end of the pipe sending results.
+     */
+    [[noreturn]] inline auto serve(int task_fd, int result_fd) -> void
+    {
+        worker_thread = true;
+
+        std::uint64_t index = 0;
+        while (read_all(task_fd, &index, sizeof(index)))
+        {
+            std::string output = {};
+            std::string crash  = {};
+
+            // Logs are sent as they are logged, so that the logs of a task
+            // that crashes or times out are not lost
+            log_capture_fd = result_fd;
+            try
+            {
+                output = (*task)(index);
+            }
+            catch (const std::exception &e)
+            {
+                crash = std::format("threw an exception: {}", e.what());
+            }
+            catch (...)
+            {
+                crash = "threw an unknown exception";
+            }
+
+            std::scoped_lock lock(capture_mutex);
+            log_capture_fd = -1;
+            if (!write_message(result_fd, pool_message::result)
+             || !write_string(result_fd, output)
+             || !write_string(result_fd, crash))
+            {
+                break;
+            }
+        }
+
+        // Skip the destructors of everything copied from the parent
+        ::_exit(0);
+    }
+
+    /**
+     *  @brief  Fork a worker.
+     *  @param  worker  Worker to start.
+     */
+    inline auto start(pool_worker &worker) -> void
+    {
+        int task_pipe[2]   = { -1, -1 };
+        int result_pipe[2] = { -1, -1 };
+        auto close_pipes = [&]() {
+            for (int fd : { task_pipe[0], task_pipe[1], result_pipe[0],
+                result_pipe[1] })
+            {
+                if (fd >= 0) ::close(fd);
+            }
+        };
+
+        if (::pipe(task_pipe) != 0 || ::pipe(result_pipe) != 0)
+        {
+            auto code = errno;
+            close_pipes();
+            throw std::system_error(code, std::generic_category(),
+                "Cannot create pipes for a worker process");
+        }
+
+        // Pending logs of this process would be written twice otherwise
+        log_flush();
+
+        pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            auto code = errno;
+            close_pipes();
+            throw std::system_error(code, std::generic_category(),
+                "Cannot fork a worker process");
+        }
+
+        if (pid == 0)
+        {
+            writer.forked = true;
+            writer.head.store(nullptr);
+
+            // Other workers must see EOF when this process' pipes close
+            for (auto &other : workers)
+            {
+                if (other.task_fd >= 0) ::close(other.task_fd);
+                if (other.result_fd >= 0) ::close(other.result_fd);
+            }
+            ::close(task_pipe[1]);
+            ::close(result_pipe[0]);
+            serve(task_pipe[0], result_pipe[1]);
+        }
+
+        ::close(task_pipe[0]);
+        ::close(result_pipe[1]);
+        worker.pid       = pid;
+        worker.task_fd   = task_pipe[1];
+        worker.result_fd = result_pipe[0];
+        worker.index     = std::nullopt;
+        worker.log.clear();
+    }
+
+    /**
+     *  @brief   Close a worker's pipes and wait for it to end.
+     *
+     *  @param   worker  Worker to stop.
+     *  @return  Status from @c waitpid .
+     */
+    inline auto stop(pool_worker &worker) -> int
+    {
+        if (worker.task_fd >= 0) ::close(worker.task_fd);
+        if (worker.result_fd >= 0) ::close(worker.result_fd);
+        worker.task_fd   = -1;
+        worker.result_fd = -1;
+
+        int status = 0;
+        if (worker.pid > 0)
+        {
+            while (::waitpid(worker.pid, &status, 0) < 0 && errno == EINTR)
+            {}
+        }
+        worker.pid = -1;
+        return status;
+    }
+
+    /**
+     *  @brief   Send a task to an idle worker, replacing the worker if it is
+     *           gone.
+     *
+     *  @param   worker  Idle worker.
+     *  @param   index   Index of the task.
+     */
+    inline auto send(pool_worker &worker, std::size_t index) -> void
+    {
+        std::uint64_t value = index;
+        if (!write_all(worker.task_fd, &value, sizeof(value)))
+        {
+            stop(worker);
+            start(worker);
+            if (!write_all(worker.task_fd, &value, sizeof(value)))
+            {
+                throw std::runtime_error("Cannot send a task to a worker "
+                                         "process");
+            }
+        }
+        worker.index = index;
+    }
+
+    /**
+     *  @brief   Receive a message from a worker, replacing the worker if it
+     *           crashed.
+     *
+     *  @param   worker  Busy worker whose result pipe is readable.
+     *  @return  The result, or nothing if the message was a log.
+     */
+    [[nodiscard]] inline auto receive(pool_worker &worker)
+    -> std::optional<process_result>
+    {
+        process_result result = {};
+        pool_message   kind   = {};
+        std::string    text   = {};
+        if (read_all(worker.result_fd, &kind, sizeof(kind)))
+        {
+            if (kind == pool_message::log)
+            {
+                if (read_string(worker.result_fd, text))
+                {
+                    worker.log += text;
+                    return std::nullopt;
+                }
+            }
+            else if (read_string(worker.result_fd, result.output)
+                  && read_string(worker.result_fd, result.crash))
+            {
+                result.log = std::move(worker.log);
+                worker.log.clear();
+                return result;
+            }
+        }
+
+        result.log   = std::move(worker.log);
+        result.crash = describe_status(stop(worker));
+        start(worker);
+        return result;
+    }
+
+    /**
+     *  @brief   Kill a busy worker and replace it.
+     *
+     *  @param   worker  Busy worker.
+     *  @return  Logs of its task, including those still in the pipe.
+     */
+    [[nodiscard]] inline auto kill(pool_worker &worker) -> std::string
+    {
+        ::kill(worker.pid, SIGKILL);
+        while (::waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {}
+        worker.pid = -1;
+
+        // Only what is already there is read, as a process the task started
+        // may still hold the pipe open
+        pool_message kind = {};
+        std::string  text = {};
+        pollfd       fd   = { worker.result_fd, POLLIN, 0 };
+        while (::poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN)
+            && read_all(worker.result_fd, &kind, sizeof(kind))
+            && kind == pool_message::log
+            && read_string(worker.result_fd, text))
+        {
+            worker.log += text;
+        }
+
+        auto log = std::move(worker.log);
+        stop(worker);
+        start(worker);
+        return log;
+    }
+};
+
+/**
+ *  @brief  Pipe that wakes up @c poll on its read end when written to.
+ */
+struct self_pipe {
+
+    /**
+     *  @brief  Read and write ends, non-blocking.
+     */
+    int fds[2] = { -1, -1 };
+
+    /**
+     *  @brief  Create the pipe.
+     *  @throws std::system_error  If the pipe cannot be created.
+     */
+    inline self_pipe()
+    {
+        if (::pipe(fds) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(),
+                "Cannot create a pipe to wake up the process pool");
+        }
+        for (auto fd : fds)
+        {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    self_pipe(const self_pipe &) = delete;
+    auto operator=(const self_pipe &) -> self_pipe & = delete;
+
+    inline ~self_pipe()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    /**
+     *  @brief  Wake up @c poll , from any thread.
+     */
+    inline auto wake() const -> void
+    {
+        char byte = 0;
+        [[maybe_unused]] auto written = ::write(fds[1], &byte, 1);
+    }
+};
+
+auto run_process_pool(
+    std::size_t                                                 count,
+    std::size_t                                                 workers,
+    const std::function<std::string (std::size_t)>             &task,
+    const std::function<bool (std::size_t, process_result &&)> &done,
+    const std::vector<std::chrono::nanoseconds>                &timeouts,
+    std::chrono::steady_clock::time_point                       deadline,
+    std::stop_token                                             token
+) -> void
+{
+    if (count == 0) return;
+
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    workers = std::clamp<std::size_t>(workers, 1, count);
+
+    // A worker that dies must not take this process with it
+    auto previous_sigpipe = std::signal(SIGPIPE, SIG_IGN);
+
+    try
+    {
+        process_pool pool = { .task = &task };
+        pool.workers.resize(workers);
+        for (auto &worker : pool.workers) pool.start(worker);
+
+        std::size_t next      = 0;
+        std::size_t busy      = 0;
+        bool        cancelled = false;
+
+        auto dispatch = [&](pool_worker &worker) {
+            if (cancelled || next >= count) return;
+
+            auto timeout = timeouts.empty() ? std::chrono::nanoseconds()
+                                            : timeouts[next];
+            worker.deadline = timeout.count() != 0
+                            ? std::chrono::steady_clock::now() + timeout
+                            : std::chrono::steady_clock::time_point::max();
+            pool.send(worker, next++);
+            busy++;
+        };
+
+        auto finish = [&](
+            pool_worker     &worker,
+            std::size_t      index,
+            process_result &&result
+        ) {
+            worker.index = std::nullopt;
+            busy--;
+
+            if (!done(index, std::move(result))) cancelled = true;
+            dispatch(worker);
+        };
+
+        // Kill the running workers, as they cannot see a stop request
+        auto cancel = [&]() {
+            cancelled = true;
+            for (auto &worker : pool.workers)
+            {
+                if (!worker.index) continue;
+
+                std::size_t index = *worker.index;
+                auto        log   = pool.kill(worker);
+                finish(worker, index, { .log = std::move(log),
+                    .crash = "cancelled", .cancelled = true });
+            }
+        };
+
+        for (auto &worker : pool.workers) dispatch(worker);
+
+        // A stop is requested from another thread, which wakes up poll
+        self_pipe         stop_pipe = {};
+        std::stop_callback on_stop(token, [&]() { stop_pipe.wake(); });
+
+        std::vector<pollfd> fds = {};
+        while (busy > 0)
+        {
+            fds.clear();
+            fds.push_back({ stop_pipe.fds[0], POLLIN, 0 });
+            auto wake = deadline;
+            for (auto &worker : pool.workers)
+            {
+                if (!worker.index) continue;
+                fds.push_back({ worker.result_fd, POLLIN, 0 });
+                wake = std::min(wake, worker.deadline);
+            }
+
+            // Wake up in time for the earliest timeout, rounding up
+            int wait = -1;
+            if (wake != std::chrono::steady_clock::time_point::max())
+            {
+                auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                    wake - std::chrono::steady_clock::now());
+                wait = (int)std::clamp<std::int64_t>(left.count(), 0,
+                    std::numeric_limits<int>::max());
+            }
+
+            if (::poll(fds.data(), fds.size(), wait) < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(),
+                    "Cannot poll worker processes");
+            }
+
+            for (auto &fd : fds)
+            {
+                if (fd.revents == 0 || fd.fd == stop_pipe.fds[0]) continue;
+
+                auto &worker = *std::ranges::find(pool.workers, fd.fd,
+                    &pool_worker::result_fd);
+                std::size_t index  = *worker.index;
+                auto        result = pool.receive(worker);
+                if (result) finish(worker, index, std::move(*result));
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (cancelled || now >= deadline || token.stop_requested())
+            {
+                cancel();
+                continue;
+            }
+
+            for (auto &worker : pool.workers)
+            {
+                if (!worker.index || now < worker.deadline) continue;
+
+                // The result may have arrived just in time, but the worker is
+                // killed anyway, as it is not known where it is
+                std::size_t    index  = *worker.index;
+                process_result result = {
+                    .log       = pool.kill(worker),
+                    .crash     = std::format("timed out after {}",
+                        std::chrono::duration<double, std::milli>(
+                            timeouts[index])),
+                    .timed_out = true
+                };
+                finish(worker, index, std::move(result));
+            }
+        }
+    }
+    catch (...)
+    {
+        std::signal(SIGPIPE, previous_sigpipe);
+        throw;
+    }
+
+    std::signal(SIGPIPE, previous_sigpipe);
+}
+
+#else // if defined(__unix__) || defined(__APPLE__)
+
+auto run_process_pool(
+    [[maybe_unused]] std::size_t                                count,
+    [[maybe_unused]] std::size_t                                workers,
+    [[maybe_unused]] const std::function<std::string (std::size_t)> &task,
+    [[maybe_unused]] const std::function<bool (std::size_t,
+        process_result &&)>                                     &done,
+    [[maybe_unused]] const std::vector<std::chrono::nanoseconds> &timeouts,
+    [[maybe_unused]] std::chrono::steady_clock::time_point      deadline,
+    [[maybe_unused]] std::stop_token                            token
+) -> void
+{
+    throw std::runtime_error("run_mode::process is only available on POSIX "
+                             "systems");
+}
+
+#endif // if defined(__unix__) || defined(__APPLE__)
+
+mapped_file::mapped_file(const std::string &path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0)
+    {
+        throw std::system_error(errno, std::generic_category(),
+            std::format("Cannot open {}", path));
+    }
+
+    struct stat status = {};
+    if (::fstat(descriptor, &status) != 0)
+    {
+        auto code = errno;
+        ::close(descriptor);
+        throw std::system_error(code, std::generic_category(),
+            std::format("Cannot get the size of {}", path));
+    }
+
+    // An empty file cannot be mapped, and needs no mapping anyway
+    size = (std::size_t)status.st_size;
+    if (size != 0)
+    {
+        auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+            descriptor, 0);
+        if (address == MAP_FAILED)
+        {
+            auto code = errno;
+            ::close(descriptor);
+            throw std::system_error(code, std::generic_category(),
+                std::format("Cannot map {}", path));
+        }
+        ::madvise(address, size, MADV_SEQUENTIAL);
+        data = (const std::byte *)address;
+    }
+    ::close(descriptor);
+#else // if defined(__unix__) || defined(__APPLE__)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::system_error(std::make_error_code(
+            std::errc::no_such_file_or_directory), std::format("Cannot open {}",
+            path));
+    }
+
+    buffer.resize((std::size_t)file.tellg());
+    file.seekg(0);
+    file.read((char *)buffer.data(), (std::streamsize)buffer.size());
+    data = buffer.data();
+    size = buffer.size();
+#endif // if defined(__unix__) || defined(__APPLE__)
+}
+
+mapped_file::~mapped_file()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (data) ::munmap((void *)data, size);
+#endif // if defined(__unix__) || defined(__APPLE__)
+}
+
+/**
+ *  @brief   Format bytes around an offset in hexadecimal, with the byte at
+ *           the offset in brackets.
+ *
+ *  @param   bytes   Bytes.
+ *  @param   offset  Offset.
+ *  @return  The formatted bytes, with "(end)" if the offset is past them.
+ */
+static auto format_snapshot_context(
+    std::span<const std::byte> bytes,
+    std::size_t                offset
+) -> std::string
+{
+    auto begin = offset - std::min(offset, snapshot_context_size);
+    auto end   = std::min(offset + snapshot_context_size + 1, bytes.size());
+
+    std::string text = {};
+    for (auto index = begin; index < end; index++)
+    {
+        if (index != begin) text += ' ';
+        auto byte = std::format("{:02x}", (unsigned)bytes[index]);
+        text += index == offset ? std::format("[{}]", byte) : byte;
+    }
+    if (offset >= bytes.size()) text += text.empty() ? "(end)" : " (end)";
+    return text;
+}
+
+/**
+ *  @brief   Find the first differing byte of two byte sequences.
+ *
+ *  @param   a  Bytes.
+ *  @param   b  Other bytes.
+ *  @return  Offset of the first difference, if any.
+ */
+static auto find_first_difference(
+    std::span<const std::byte> a,
+    std::span<const std::byte> b
+) -> std::optional<std::size_t>
+{
+    constexpr std::size_t chunk_size = 64 * 1024;
+
+    // Equal chunks are skipped with memcmp, and only the differing chunk is
+    // searched byte by byte
+    auto common = std::min(a.size(), b.size());
+    for (std::size_t begin = 0; begin < common; begin += chunk_size)
+    {
+        auto size = std::min(chunk_size, common - begin);
+        if (std::memcmp(a.data() + begin, b.data() + begin, size) == 0)
+        {
+            continue;
+        }
+
+        auto chunk = a.subspan(begin, size);
+        auto [mismatch, _] = std::ranges::mismatch(chunk,
+            b.subspan(begin, size));
+        return begin + (std::size_t)(mismatch - chunk.begin());
+    }
+
+    if (a.size() != b.size()) return common;
+    return std::nullopt;
+}
+
+/**
+ *  @brief  Write a golden file atomically.
+ *
+ *  @param  path   Path to the golden file.
+ *  @param  bytes  Contents.
+ *  @throws std::runtime_error  If the file cannot be written.
+ */
+static auto write_snapshot(
+    const std::string         &path,
+    std::span<const std::byte> bytes
+) -> void
+{
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+
+    // Write next to the file and rename over it, so that readers never see
+    // a partially written snapshot.  The temporary file is named after the
+    // process and the thread, so that tests updating the same snapshot, in
+    // worker processes or threads, do not collide
+#if defined(__unix__) || defined(__APPLE__)
+    auto process = (std::uint64_t)::getpid();
+#else // if defined(__unix__) || defined(__APPLE__)
+    auto process = (std::uint64_t)std::random_device()();
+#endif // if defined(__unix__) || defined(__APPLE__)
+    auto temporary = std::format("{}.{}.{}.tmp", path, process,
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write((const char *)bytes.data(), (std::streamsize)bytes.size());
+        if (!file.flush())
+        {
+            throw std::runtime_error(std::format("Cannot write snapshot file "
+                "{}", temporary));
+        }
+    }
+
+    std::error_code error = {};
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error(std::format("Cannot replace snapshot file {}",
+            path));
+    }
+}
+
+auto check_snapshot(
+    std::span<const std::byte> actual,
+    const std::string         &path
+) -> snapshot_result
+{
+    snapshot_result result = {};
+    bool update = update_snapshots
+               || read_environment_number("CONFER_UPDATE_SNAPSHOTS")
+                      .value_or(0) != 0;
+
+    std::error_code error = {};
+    if (!std::filesystem::exists(path, error))
+    {
+        if (update)
+        {
+            write_snapshot(path, actual);
+            result.updated = true;
+            logln("Created snapshot {}", path);
+            return result;
+        }
+
+        result.passed = false;
+        logln("Snapshot {} does not exist, set CONFER_UPDATE_SNAPSHOTS=1 to "
+            "create it", path);
+        return result;
+    }
+
+    {
+        mapped_file golden(path);
+        result.first_difference = find_first_difference(golden.bytes(),
+            actual);
+        if (!result.first_difference) return result;
+
+        if (!update)
+        {
+            auto offset = *result.first_difference;
+            result.passed = false;
+            logln("Snapshot {} differs at offset {} (expected {} bytes, got "
+                "{} bytes)", path, offset, golden.size, actual.size());
+            logln("  Expected: {}", format_snapshot_context(golden.bytes(),
+                offset));
+            logln("  Actual:   {}", format_snapshot_context(actual, offset));
+            return result;
+        }
+    }
+
+    // The mapping is closed before the file is replaced
+    write_snapshot(path, actual);
+    result.updated = true;
+    logln("Updated snapshot {}", path);
+    return result;
+}
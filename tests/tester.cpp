@@ -38,19 +38,1246 @@
  *    "Standard".
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "confer.hpp"
 
+// Containers of tests and hooks must move them rather than copy them when
+// they grow
+static_assert(std::is_nothrow_move_constructible_v<test_case>);
+static_assert(std::is_nothrow_move_constructible_v<test_reporter>);
+
+/**
+ *  @brief   Count out of tolerance values, against the expected values of
+ *           the infinity and NaN cases.
+ *
+ *  @tparam  type       Floating-point type.
+ *  @param   tolerance  Tolerance.
+ *  @return  Number of values out of tolerance.
+ */
+template<std::floating_point type>
+[[nodiscard]] static auto count_special(struct tolerance tolerance)
+{
+    constexpr auto infinity = std::numeric_limits<type>::infinity();
+    constexpr auto nan      = std::numeric_limits<type>::quiet_NaN();
+
+    std::vector<type> value    = { infinity, -infinity, infinity, -infinity,
+                                   nan, nan, (type)1, (type)2 };
+    std::vector<type> expected = { (type)1, infinity, infinity, -infinity,
+                                   nan, (type)1, nan, (type)2 };
+    return compare_approx(value, expected, tolerance, "value", "expected");
+}
+
+CT_TEST(test_approx_special_values, "Approximate comparison of infinities "
+    "and NaN") {
+    CT_BEGIN;
+
+    // Only the equal infinities and the equal finite values are within
+    // tolerance, whatever the tolerance
+    for (auto tolerance : { absolute_tolerance(1e300),
+        relative_tolerance(0.5), ulp_tolerance(1) })
+    {
+        CT_ASSERT(count_special<float>(tolerance), 5uz, "float");
+        CT_ASSERT(count_special<double>(tolerance), 5uz, "double");
+    }
+
+    CT_ASSERT(approx_error(std::numeric_limits<float>::infinity(), 1.0f,
+        tolerance_mode::relative), std::numeric_limits<double>::infinity(),
+        "Relative error of an infinity");
+
+    CT_END;
+}
+
+/**
+ *  @brief   Count out of relative tolerance values, with the tolerance at
+ *           the error of the values.
+ *
+ *  @tparam  type      Floating-point type.
+ *  @param   value     Value.
+ *  @param   expected  Expected value.
+ *  @param   scale     Scale of the tolerance relative to the error.
+ *  @return  Number of values out of tolerance.
+ */
+template<std::floating_point type>
+[[nodiscard]] static auto count_at_limit(type value, type expected,
+    double scale)
+{
+    auto error     = approx_error(value, expected, tolerance_mode::relative);
+    auto tolerance = relative_tolerance(error * scale);
+    return compare_approx(std::vector { value }, std::vector { expected },
+        tolerance, "value", "expected");
+}
+
+CT_TEST(test_approx_relative_limit, "Relative tolerance at the limit") {
+    CT_BEGIN;
+
+    // The count agrees with the reported error for float and double alike
+    auto next_float  = std::nextafter(1.0f, 2.0f);
+    auto next_double = std::nextafter(1.0, 2.0);
+    CT_ASSERT(count_at_limit(1.0f, next_float, 1.0), 0uz, "float at limit");
+    CT_ASSERT(count_at_limit(1.0f, next_float, 0.99), 1uz, "float past limit");
+    CT_ASSERT(count_at_limit(3.0, 3.0 + 1e-9, 1.0), 0uz, "double at limit");
+    CT_ASSERT(count_at_limit(1.0, next_double, 0.99), 1uz,
+        "double past limit");
+
+    CT_END;
+}
+
+CT_TEST(test_container_single_evaluation, "Container assertions evaluate "
+    "their operands once") {
+    CT_BEGIN;
+
+    std::size_t calls = 0;
+    auto make = [&](auto value) {
+        calls++;
+        return value;
+    };
+    std::vector<std::vector<double>> nested = { { 1.0, 2.0 }, { 3.0 } };
+
+    CT_ASSERT_CTR(make(nested), make(nested));
+    CT_ASSERT_SUB_CTR(make(nested), make(nested), 0);
+    CT_ASSERT_NEST_CTR(make(nested), make(nested));
+    CT_ASSERT_APPROX_CTR(make(nested[0]), make(nested[0]),
+        absolute_tolerance(0.0));
+    CT_ASSERT(calls, 8uz, "Operand evaluations");
+
+    CT_END;
+}
+
+CT_TEST(test_property_bool, "Properties of bools shrink to the simplest "
+    "failing value") {
+    CT_BEGIN;
+
+    // Shrinking a bool gives a std::vector<bool>, whose elements are
+    // proxies.  On one worker, the last failing value is the counterexample
+    property_options options = {
+        .cases = 10, .seed = 1, .max_size = 64, .workers = 1
+    };
+
+    auto single = check_property("bool", bool_generator {},
+        [](bool value) { return !value; }, options);
+    CT_ASSERT(single.passed, false, "bool property");
+
+    std::vector<bool> last_vector = {};
+    auto vector = check_property("vector of bools",
+        vector_of(bool_generator {}, 64),
+        [&](const std::vector<bool> &value) {
+            if (std::ranges::count(value, true) < 2) return true;
+            last_vector = value;
+            return false;
+        }, options);
+    CT_ASSERT(vector.passed, false, "vector property");
+    CT_ASSERT((last_vector == std::vector { true, true }), true,
+        "vector shrunk");
+
+    int  last_number = 0;
+    auto tuple       = check_property("tuple with a bool",
+        tuple_of(bool_generator {}, integral_generator<int> { 0, 100 }),
+        [&](bool flag, int number) {
+            if (!flag || number < 10) return true;
+            last_number = number;
+            return false;
+        }, options);
+    CT_ASSERT(tuple.passed, false, "tuple property");
+    CT_ASSERT(last_number, 10, "tuple shrunk");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that passes, run by the tests of @c test_suite .
+ */
+static CT_TESTER_FN(inner_pass)
+{
+    CT_BEGIN;
+    CT_END;
+}
+
+/**
+ *  @brief  Test that fails, run by the tests of @c test_suite .
+ */
+static CT_TESTER_FN(inner_fail)
+{
+    CT_BEGIN;
+    CT_ASSERT(1, 2, "Inner test");
+    CT_END;
+}
+
+/**
+ *  @brief  Test that takes a while unless cancelled, run by the tests of
+ *          @c test_suite .
+ */
+static CT_TESTER_FN(inner_slow)
+{
+    CT_BEGIN;
+    for (int i = 0; i < 20; i++)
+    {
+        CT_CHECK_CANCELLED;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CT_END;
+}
+
+CT_TEST(test_parallel_failed_order, "Failed tests of a parallel run are in "
+    "the order of the tests") {
+    CT_BEGIN;
+
+    test_case first = {
+        .title         = "First",
+        .function_name = "inner_fail",
+        .function      = inner_fail
+    };
+
+    test_case slow = {
+        .title         = "Slow",
+        .function_name = "inner_slow",
+        .function      = inner_slow
+    };
+
+    test_case second = {
+        .title         = "Second",
+        .function_name = "inner_fail",
+        .function      = inner_fail
+    };
+
+    test_case pass = {
+        .title         = "Pass",
+        .function_name = "inner_pass",
+        .function      = inner_pass
+    };
+
+    test_case third = {
+        .title         = "Third",
+        .function_name = "inner_fail",
+        .function      = inner_fail
+    };
+
+    test_suite suite = {
+        .tests   = { &first, &slow, &second, &pass, &third },
+        .mode    = run_mode::parallel,
+        .workers = 4
+    };
+    auto failed = suite.run();
+    CT_ASSERT_END(failed.size(), 3uz, "Failed tests");
+    CT_ASSERT(failed[0].first == &first, true, "First failed test");
+    CT_ASSERT(failed[1].first == &second, true, "Second failed test");
+    CT_ASSERT(failed[2].first == &third, true, "Third failed test");
+    CT_ASSERT(suite.results.size(), 5uz, "Results");
+
+    CT_END;
+}
+
+CT_TEST(test_parallel_fail_fast, "A failure cancels the rest of a parallel "
+    "run") {
+    CT_BEGIN;
+
+    test_case fail = {
+        .title         = "Fail",
+        .function_name = "inner_fail",
+        .function      = inner_fail
+    };
+
+    test_case slow = {
+        .title         = "Slow",
+        .function_name = "inner_slow",
+        .function      = inner_slow
+    };
+
+    std::vector<const test_case *> tests = { &fail };
+    tests.resize(17, &slow);
+
+    test_suite suite = {
+        .tests      = tests,
+        .run_failed = [](const test_case *, CT_ERRORS_TYPE) { return true; },
+        .mode       = run_mode::parallel,
+        .workers    = 2
+    };
+    auto failed = suite.run();
+    CT_ASSERT_END(failed.size(), 1uz, "Failed tests");
+    CT_ASSERT(failed[0].first == &fail, true, "Failed test");
+
+    // Only the tests that had started by then ran at all
+    CT_ASSERT(suite.results.size() < tests.size(), true, "Tests cancelled");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that sleeps past its timeout, run by @c test_timeouts .
+ */
+static CT_TESTER_FN(inner_sleepy)
+{
+    CT_BEGIN;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CT_END;
+}
+
+CT_TEST(test_timeouts, "A test past its timeout fails and the run "
+    "continues") {
+    CT_BEGIN;
+
+    // An abandoned test keeps running after the run, so its test case and
+    // suite must outlive it
+    static test_case sleepy = {
+        .title         = "Sleepy",
+        .function_name = "inner_sleepy",
+        .function      = inner_sleepy,
+        .timeout       = std::chrono::milliseconds(20)
+    };
+
+    static test_case pass = {
+        .title         = "Pass",
+        .function_name = "inner_pass",
+        .function      = inner_pass
+    };
+
+    static test_suite suite = { .tests = { &sleepy, &pass } };
+    for (auto mode : { run_mode::sequential, run_mode::parallel,
+        run_mode::process })
+    {
+        suite.mode = mode;
+        auto failed = suite.run();
+        CT_ASSERT_END(failed.size(), 1uz, "Failed tests");
+        CT_ASSERT(failed[0].first == &sleepy, true, "Timed out test");
+        CT_ASSERT(failed[0].second, 1uz, "Errors of the timed out test");
+        CT_ASSERT_END(suite.results.size(), 2uz, "Results");
+        CT_ASSERT(suite.results[1].test == &pass, true, "Run continued");
+        CT_ASSERT(CT_HAS_ERRORS(suite.results[1].errors), false,
+            "Errors of the test after");
+    }
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that logs and crashes with a segmentation fault, run by
+ *          @c test_process_crashes .
+ */
+static CT_TESTER_FN(inner_segfault)
+{
+    CT_BEGIN;
+    logln("Inner test about to segfault");
+    std::raise(SIGSEGV);
+    CT_END;
+}
+
+/**
+ *  @brief  Test that logs and calls @c std::terminate , run by
+ *          @c test_process_crashes .
+ */
+static CT_TESTER_FN(inner_terminate)
+{
+    logln("Inner test about to terminate");
+    std::terminate();
+}
+
+CT_TEST(test_process_crashes, "Crashing tests of a process run fail, keep "
+    "their logs and the run continues") {
+    CT_BEGIN;
+
+    test_case segfault = {
+        .title         = "Segfault",
+        .function_name = "inner_segfault",
+        .function      = inner_segfault
+    };
+
+    test_case terminate = {
+        .title         = "Terminate",
+        .function_name = "inner_terminate",
+        .function      = inner_terminate
+    };
+
+    test_case pass = {
+        .title         = "Pass",
+        .function_name = "inner_pass",
+        .function      = inner_pass
+    };
+
+    auto path = (std::filesystem::temp_directory_path()
+        / "confer_tester_crashes.log").string();
+
+    test_suite suite = {
+        .tests   = { &segfault, &terminate, &pass },
+        .mode    = run_mode::process,
+        .workers = 1
+    };
+    log_file.open(path);
+    auto failed = suite.run();
+    log_file.close();
+
+    std::ifstream file(path);
+    std::string   logged((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(path);
+
+    CT_ASSERT_END(failed.size(), 2uz, "Failed tests");
+    CT_ASSERT(failed[0].first == &segfault, true, "Segfaulted test");
+    CT_ASSERT(failed[1].first == &terminate, true, "Terminated test");
+    CT_ASSERT(failed[0].second, 1uz, "Errors of the segfaulted test");
+    CT_ASSERT(failed[1].second, 1uz, "Errors of the terminated test");
+    CT_ASSERT_END(suite.results.size(), 3uz, "Results");
+    CT_ASSERT(suite.results[2].test == &pass, true, "Run continued");
+
+    CT_ASSERT(logged.contains("Inner test about to segfault"), true,
+        "Log of the segfaulted test");
+    CT_ASSERT(logged.contains("Inner test about to terminate"), true,
+        "Log of the terminated test");
+    CT_ASSERT(logged.contains("Segfault crashed"), true,
+        "Crash of the segfaulted test");
+
+    CT_END;
+}
+
+CT_TEST(test_cancelled_results, "Only tests that return early are marked "
+    "cancelled") {
+    CT_BEGIN;
+
+    test_case slow = {
+        .title         = "Slow",
+        .function_name = "inner_slow",
+        .function      = inner_slow
+    };
+
+    test_case pass = {
+        .title         = "Pass",
+        .function_name = "inner_pass",
+        .function      = inner_pass
+    };
+
+    // The run is stopped after each test starts
+    auto run = [&](const test_case *test) {
+        test_suite suite = { .tests = { test } };
+        suite.pre_run = [&](const test_case *) { suite.stop.request_stop(); };
+        (void)suite.run();
+        return suite.results;
+    };
+
+    auto stopped = run(&slow);
+    CT_ASSERT_END(stopped.size(), 1uz, "Stopped results");
+    CT_ASSERT(stopped[0].cancelled, true, "Stopped test cancelled");
+
+    auto completed = run(&pass);
+    CT_ASSERT_END(completed.size(), 1uz, "Completed results");
+    CT_ASSERT(completed[0].cancelled, false, "Completed test cancelled");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that takes a while without checking for cancellation, run by
+ *          the tests of @c test_suite .
+ */
+static CT_TESTER_FN(inner_oblivious)
+{
+    CT_BEGIN;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CT_END;
+}
+
+CT_TEST(test_run_timeout_not_run, "Tests not run before the run timed out "
+    "fail") {
+    CT_BEGIN;
+
+    test_case oblivious = {
+        .title         = "Oblivious",
+        .function_name = "inner_oblivious",
+        .function      = inner_oblivious
+    };
+
+    test_case pass = {
+        .title         = "Pass",
+        .function_name = "inner_pass",
+        .function      = inner_pass
+    };
+
+    // The first test completes after the run timed out, so the others never
+    // start
+    for (auto mode : { run_mode::sequential, run_mode::parallel })
+    {
+        test_suite suite = {
+            .tests       = { &oblivious, &pass, &pass },
+            .mode        = mode,
+            .workers     = 1,
+            .run_timeout = std::chrono::milliseconds(10)
+        };
+        auto failed = suite.run();
+        CT_ASSERT_END(failed.size(), 2uz, "Failed tests");
+        CT_ASSERT(failed[0].first == &pass, true, "First failed test");
+        CT_ASSERT_END(suite.results.size(), 3uz, "Results");
+        CT_ASSERT(suite.results[0].cancelled, false, "Completed test");
+        CT_ASSERT(suite.results[1].cancelled, true, "Test not run");
+    }
+
+    CT_END;
+}
+
+CT_TEST(test_shards_partition, "Shards are disjoint and cover every test") {
+    CT_BEGIN;
+
+    std::vector<test_case> cases = {};
+    for (std::size_t i = 0; i < 23; i++)
+    {
+        cases.push_back({
+            .title         = std::format("Test {}", i),
+            .function_name = std::format("test_{}", i),
+            .function      = inner_pass
+        });
+    }
+    std::vector<const test_case *> candidates = {};
+    for (auto &test : cases) candidates.emplace_back(&test);
+
+    // Balanced by count, then by recorded durations with some missing
+    test_suite suite = {};
+    for (bool timed : { false, true })
+    {
+        if (timed)
+        {
+            for (std::size_t i = 0; i < cases.size(); i += 2)
+            {
+                suite.shard_durations[cases[i].function_name] = (double)i;
+            }
+        }
+
+        for (std::size_t count : { 1uz, 2uz, 5uz, 23uz, 30uz })
+        {
+            std::vector<std::size_t> runs(candidates.size(), 0);
+            suite.shard_count = count;
+            for (std::size_t index = 0; index < count; index++)
+            {
+                suite.shard_index = index;
+                auto shard = suite.shard_tests(candidates);
+                CT_ASSERT(std::ranges::is_sorted(shard), true,
+                    "Shard in the order of the tests");
+                CT_ASSERT(shard == suite.shard_tests(candidates), true,
+                    "Same shard again");
+                for (auto test : shard)
+                {
+                    runs[(std::size_t)(test - cases.data())]++;
+                }
+            }
+            CT_ASSERT((std::size_t)std::ranges::count(runs, 1uz),
+                candidates.size(), "Tests run by exactly one shard");
+        }
+    }
+
+    CT_END;
+}
+
+CT_TEST(test_mismatch_ranges, "Mismatches collapse into ranges up to the "
+    "report limit") {
+    CT_BEGIN;
+
+    // A range across a block compared with memcmp, a single element and a
+    // range at the end, which is past the limit
+    std::vector<int> value(10000, 0);
+    std::vector<int> expected(10000, 0);
+    for (std::size_t i = 1020; i < 1030; i++) value[i] = 1;
+    value[5000] = 1;
+    for (std::size_t i = 9990; i < 10000; i++) value[i] = 1;
+
+    std::list<int> value_list(value.begin(), value.end());
+    std::list<int> expected_list(expected.begin(), expected.end());
+    for (bool contiguous : { true, false })
+    {
+        mismatch_report report = {
+            .value_name    = "value",
+            .expected_name = "expected",
+            .limit         = 2
+        };
+        if (contiguous) compare_ranges(value, expected, report);
+        else compare_ranges(value_list, expected_list, report);
+
+        CT_ASSERT(report.ranges, 3uz, "Ranges");
+        CT_ASSERT(report.range_begin, 9990uz, "Last range begin");
+        CT_ASSERT(report.range_first.empty(), true,
+            "Range past the limit not formatted");
+        CT_ASSERT(report.finish(), 21uz, "Mismatches");
+    }
+
+    // Ranges do not continue into the next nested container
+    mismatch_report report = { .value_name = "value",
+        .expected_name = "expected" };
+    report.outer = 0;
+    report.add(3, 1, 0);
+    report.outer = 1;
+    report.add(4, 1, 0);
+    CT_ASSERT(report.ranges, 2uz, "Nested ranges");
+    CT_ASSERT(report.finish(), 2uz, "Nested mismatches");
+
+    CT_ASSERT(compare_ranges(value, expected, "value", "expected"), 21uz,
+        "Mismatches of compare_ranges");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that throws, run by the tests of @c test_suite .
+ */
+static CT_TESTER_FN(inner_throw)
+{
+    throw std::runtime_error("Inner test");
+}
+
+CT_TEST(test_reporter_end_on_throw, "Reports are complete when a test "
+    "throws") {
+    CT_BEGIN;
+
+    auto path = (std::filesystem::temp_directory_path()
+        / "confer_tester_junit.xml").string();
+
+    test_case thrower = {
+        .title         = "Throw",
+        .function_name = "inner_throw",
+        .function      = inner_throw
+    };
+
+    test_suite suite = {
+        .tests     = { &thrower },
+        .reporters = { junit_reporter(path) }
+    };
+
+    bool thrown = false;
+    try
+    {
+        (void)suite.run();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    CT_ASSERT(thrown, true, "Exception of the test");
+
+    std::ifstream file(path);
+    std::string   xml((std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(path);
+    CT_ASSERT(xml.ends_with("</testsuites>\n"), true, "XML closed");
+
+    CT_END;
+}
+
+CT_TEST(test_callable_heap, "Callables too large to store inline, or that "
+    "may throw when moved, are stored on the heap") {
+    CT_BEGIN;
+
+    // Three strings do not fit in the inline storage
+    std::string a(100, 'a'), b(100, 'b'), c(100, 'c');
+    callable<std::size_t ()> large = [a, b, c] {
+        return a.size() + b.size() + c.size();
+    };
+    callable<std::size_t ()> copy  = large;
+    callable<std::size_t ()> moved = std::move(large);
+    CT_ASSERT(copy(), 300uz, "Copied large callable");
+    CT_ASSERT(moved(), 300uz, "Moved large callable");
+    CT_ASSERT((bool)large, false, "Moved from large callable");
+
+    // A const string is copied when the lambda is moved, which may throw
+    const std::string name = "name";
+    callable<std::string ()> throwing = [name] { return name; };
+    callable<std::string ()> moved_throwing = std::move(throwing);
+    CT_ASSERT(moved_throwing(), std::string("name"),
+        "Callable that may throw when moved");
+
+    CT_END;
+}
+
+/**
+ *  @brief   Check if a test passes a filter.
+ *
+ *  @param   filter         Filter.
+ *  @param   title          Test title.
+ *  @param   function_name  Testing function's name.
+ *  @param   tags           Test tags.
+ *  @return  True if the test passes.
+ */
+[[nodiscard]] static auto passes(
+    const test_filter              &filter,
+    std::string_view                title,
+    std::string_view                function_name,
+    const std::vector<std::string> &tags = {}
+)
+{
+    return compile_filter(filter).matches(title, function_name, tags);
+}
+
+CT_TEST(test_filter_matching, "Filters match globs, regular expressions "
+    "and tags") {
+    CT_BEGIN;
+
+    // Globs match the whole title or function name
+    test_filter glob = { .include = { "test_math_*", "Sum?" } };
+    CT_ASSERT(passes(glob, "Addition", "test_math_add"), true, "Glob *");
+    CT_ASSERT(passes(glob, "Sums", "test_sums"), true, "Glob ?");
+    CT_ASSERT(passes(glob, "Sum", "test_sum"), false, "Glob ? needs one");
+    CT_ASSERT(passes(glob, "Math", "my_test_math_add"), false, "Glob whole");
+
+    // Backtracking to the last star
+    test_filter stars = { .include = { "a*b*c" } };
+    CT_ASSERT(passes(stars, "aXbYbZc", ""), true, "Stars match");
+    CT_ASSERT(passes(stars, "aXbYbZ", ""), false, "Stars mismatch");
+
+    test_filter exclude = {
+        .include = { "test_*" },
+        .exclude = { "*_slow" }
+    };
+    CT_ASSERT(passes(exclude, "Fast", "test_fast"), true, "Not excluded");
+    CT_ASSERT(passes(exclude, "Slow", "test_slow"), false, "Excluded");
+
+    test_filter tags = {
+        .include_tags = { "unit", "math" },
+        .exclude_tags = { "flaky" }
+    };
+    CT_ASSERT(passes(tags, "A", "a", { "math" }), true, "Included tag");
+    CT_ASSERT(passes(tags, "B", "b", { "io" }), false, "No included tag");
+    CT_ASSERT(passes(tags, "C", "c", { "unit", "flaky" }), false,
+        "Excluded tag");
+    CT_ASSERT(passes(tags, "D", "d"), false, "No tags");
+
+    // Regular expressions search the title or function name
+    test_filter regex = {
+        .include = { "^test_(add|sub)$" },
+        .syntax  = pattern_syntax::regex
+    };
+    CT_ASSERT(passes(regex, "Add", "test_add"), true, "Regex match");
+    CT_ASSERT(passes(regex, "Mul", "test_mul"), false, "Regex mismatch");
+
+    bool threw = false;
+    try
+    {
+        (void)compile_filter({ .include = { "(" },
+            .syntax = pattern_syntax::regex });
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    CT_ASSERT(threw, true, "Invalid regex");
+
+    // Filtered tests keep their order
+    test_case add = {
+        .title         = "Add",
+        .function_name = "test_add",
+        .function      = inner_pass
+    };
+
+    test_case mul = {
+        .title         = "Mul",
+        .function_name = "test_mul",
+        .function      = inner_pass
+    };
+
+    test_case sub = {
+        .title         = "Sub",
+        .function_name = "test_sub",
+        .function      = inner_pass
+    };
+
+    test_suite suite = { .tests = { &add, &mul, &sub }, .filter = regex };
+    CT_ASSERT((suite.filter_tests()
+        == std::vector<const test_case *> { &add, &sub }), true,
+        "Filtered tests");
+
+    CT_END;
+}
+
+/**
+ *  @brief   Check if a p-value is close to the expected one.
+ *
+ *  @param   current   Current samples.
+ *  @param   baseline  Baseline samples.
+ *  @param   expected  Expected p-value.
+ *  @return  True if the p-value is within 1e-9 of @p expected .
+ */
+[[nodiscard]] static auto p_value_near(
+    const std::vector<double> &current,
+    const std::vector<double> &baseline,
+    double                     expected
+)
+{
+    return std::abs(mann_whitney_p_value(current, baseline) - expected)
+        < 1e-9;
+}
+
+CT_TEST(test_mann_whitney, "Mann-Whitney p-values, exact and normal") {
+    CT_BEGIN;
+
+    // Exact: all 20 orders of 3 and 3 samples are equally likely, and only
+    // one has every current sample greater
+    CT_ASSERT(p_value_near({ 4, 5, 6 }, { 1, 2, 3 }, 1.0 / 20.0), true,
+        "Exact, all greater");
+    CT_ASSERT(p_value_near({ 1, 2, 3 }, { 4, 5, 6 }, 1.0), true,
+        "Exact, all less");
+
+    // U of 2 and 2 samples is 0, 1, 2, 2, 3 or 4, and here it is 3
+    CT_ASSERT(p_value_near({ 2, 4 }, { 1, 3 }, 2.0 / 6.0), true,
+        "Exact, interleaved");
+
+    CT_ASSERT(p_value_near({}, { 1, 2 }, 1.0), true, "No current samples");
+
+    // Normal approximation with a continuity correction, for large samples
+    std::vector<double> low  = {};
+    std::vector<double> high = {};
+    for (int i = 1; i <= 40; i++)
+    {
+        low.emplace_back(i);
+        high.emplace_back(i + 40);
+    }
+    CT_ASSERT(mann_whitney_p_value(high, low) < 1e-9, true,
+        "Normal, all greater");
+    CT_ASSERT(mann_whitney_p_value(low, high) > 1.0 - 1e-9, true,
+        "Normal, all less");
+
+    // 33 even against 33 odd samples: U = 561, mean 544.5, variance
+    // 33 * 33 * 67 / 12
+    std::vector<double> even = {};
+    std::vector<double> odd  = {};
+    for (int i = 1; i <= 33; i++)
+    {
+        even.emplace_back(2 * i);
+        odd.emplace_back(2 * i - 1);
+    }
+    auto z = 16.0 / std::sqrt(33.0 * 33.0 * 67.0 / 12.0);
+    CT_ASSERT(p_value_near(even, odd, 0.5 * std::erfc(z / std::sqrt(2.0))),
+        true, "Normal, interleaved");
+
+    // Ties use the normal approximation, and all ties are never significant
+    CT_ASSERT(p_value_near({ 1, 1, 1 }, { 1, 1, 1 }, 1.0), true, "All ties");
+    std::vector<double> tied_high = { 2, 2, 3 };
+    std::vector<double> tied_low  = { 1, 2, 2 };
+    CT_ASSERT(mann_whitney_p_value(tied_high, tied_low) < 0.5, true,
+        "Ties, greater");
+
+    CT_END;
+}
+
+CT_TEST(test_baseline_round_trip, "Baselines of any function name are "
+    "saved and loaded") {
+    CT_BEGIN;
+
+    auto path = (std::filesystem::temp_directory_path()
+        / "confer_tester_baseline.txt").string();
+
+    performance_baseline saved = {};
+    saved.samples["test_plain"]             = { 1.5, 2.25, 1e-9 };
+    saved.samples["name with spaces"]       = { 3.0 };
+    saved.samples[""]                       = { 4.0, 5.0 };
+    saved.samples["#comment\tand\\slash\n"] = { 6.0 };
+    saved.samples["no samples"]             = {};
+    saved.save(path);
+
+    performance_baseline loaded = {};
+    loaded.load(path);
+    std::filesystem::remove(path);
+    CT_ASSERT(loaded.samples == saved.samples, true, "Loaded samples");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Number of runs of @c inner_counted .
+ */
+static std::size_t inner_runs = 0;
+
+/**
+ *  @brief  True to fail @c inner_counted .
+ */
+static bool inner_fails = false;
+
+/**
+ *  @brief  Test that counts its runs, and fails when told to, run by the
+ *          tests of @c test_suite .
+ */
+static CT_TESTER_FN(inner_counted)
+{
+    CT_BEGIN;
+    inner_runs++;
+    CT_ASSERT(inner_fails, false, "Inner test told to fail");
+    CT_END;
+}
+
+CT_TEST(test_result_cache, "Passed tests are cached until they fail or "
+    "the fingerprint changes") {
+    CT_BEGIN;
+
+    auto path = (std::filesystem::temp_directory_path()
+        / "confer_tester_cache.bin").string();
+    std::filesystem::remove(path);
+
+    test_case counted = {
+        .title         = "Counted",
+        .function_name = "inner_counted",
+        .function      = inner_counted
+    };
+
+    auto run = [&](std::uint64_t fingerprint) {
+        test_suite suite = { .tests = { &counted } };
+        suite.cache.path        = path;
+        suite.cache.fingerprint = fingerprint;
+        (void)suite.run();
+        return suite.results.at(0).cached;
+    };
+
+    inner_runs = 0;
+    CT_ASSERT(run(1), false, "First run");
+    CT_ASSERT(run(1), true, "Cached run");
+    CT_ASSERT(inner_runs, 1uz, "Runs after a cached run");
+
+    // Another fingerprint is another build, whose results are not cached
+    CT_ASSERT(run(2), false, "Other fingerprint");
+    CT_ASSERT(run(1), true, "First fingerprint still cached");
+
+    // A failure removes the test from the cache, even if recorded passing
+    // by an earlier run
+    result_cache cache = { .path = path, .fingerprint = 2 };
+    cache.begin();
+    CT_ASSERT(cache.contains("inner_counted"), true, "Loaded");
+    cache.record("inner_counted", false);
+    cache.end();
+    cache.begin();
+    CT_ASSERT(cache.contains("inner_counted"), false, "Removed on failure");
+
+    inner_fails = true;
+    CT_ASSERT(run(2), false, "Failing run");
+    CT_ASSERT(run(2), false, "Failed test not cached");
+    inner_fails = false;
+    CT_ASSERT(inner_runs, 4uz, "Runs");
+
+    std::filesystem::remove(path);
+    CT_END;
+}
+
+/**
+ *  @brief  Async test that waits and passes, run by the tests of
+ *          @c test_suite .
+ */
+static CT_ASYNC_TESTER_FN(inner_async_pass)
+{
+    CT_BEGIN;
+    co_await async_sleep_for(std::chrono::milliseconds(100));
+    CT_CO_END;
+}
+
+/**
+ *  @brief  Async test that waits and fails, run by the tests of
+ *          @c test_suite .
+ */
+static CT_ASYNC_TESTER_FN(inner_async_fail)
+{
+    CT_BEGIN;
+    co_await async_sleep_for(std::chrono::milliseconds(100));
+    CT_ASSERT(1, 2, "Inner async test");
+    CT_CO_END;
+}
+
+CT_TEST(test_async_overlap, "Async tests overlap while they wait, with "
+    "errors counted per test") {
+    CT_BEGIN;
+
+    test_case first_pass = {
+        .title          = "First pass",
+        .function_name  = "inner_async_pass",
+        .async_function = inner_async_pass
+    };
+
+    test_case first_fail = {
+        .title          = "First fail",
+        .function_name  = "inner_async_fail",
+        .async_function = inner_async_fail
+    };
+
+    test_case second_pass = {
+        .title          = "Second pass",
+        .function_name  = "inner_async_pass",
+        .async_function = inner_async_pass
+    };
+
+    test_case second_fail = {
+        .title          = "Second fail",
+        .function_name  = "inner_async_fail",
+        .async_function = inner_async_fail
+    };
+
+    // On one thread, the four waits of 100 ms overlap
+    test_suite suite = {
+        .tests   = { &first_pass, &first_fail, &second_pass, &second_fail },
+        .mode    = run_mode::async,
+        .workers = 1
+    };
+    auto start  = std::chrono::steady_clock::now();
+    auto failed = suite.run();
+    auto wall   = std::chrono::steady_clock::now() - start;
+    CT_ASSERT(wall < std::chrono::milliseconds(300), true, "Waits overlap");
+
+    CT_ASSERT_END(failed.size(), 2uz, "Failed tests");
+    CT_ASSERT(failed[0].first == &first_fail, true, "First failed test");
+    CT_ASSERT(failed[1].first == &second_fail, true, "Second failed test");
+    CT_ASSERT(failed[0].second, 1uz, "Errors of the first failed test");
+    CT_ASSERT(failed[1].second, 1uz, "Errors of the second failed test");
+
+    CT_ASSERT_END(suite.results.size(), 4uz, "Results");
+    for (auto &result : suite.results)
+    {
+        CT_ASSERT(result.wall_time >= std::chrono::milliseconds(100), true,
+            "Wall time of each test");
+    }
+
+    // Outside run_mode::async, an async test runs to completion on its own
+    CT_ASSERT(sync_wait(inner_async_fail()), 1uz, "sync_wait errors");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Async test that waits, then returns early if the run was
+ *          stopped, run by @c test_async_cancelled .
+ */
+static CT_ASYNC_TESTER_FN(inner_async_check)
+{
+    CT_BEGIN;
+    co_await async_sleep_for(std::chrono::milliseconds(20));
+    CT_CO_CHECK_CANCELLED;
+    CT_CO_END;
+}
+
+CT_TEST(test_async_cancelled, "Async tests sharing a thread are marked "
+    "cancelled on their own") {
+    CT_BEGIN;
+
+    test_case check = {
+        .title          = "Check",
+        .function_name  = "inner_async_check",
+        .async_function = inner_async_check
+    };
+
+    test_case pass = {
+        .title          = "Pass",
+        .function_name  = "inner_async_pass",
+        .async_function = inner_async_pass
+    };
+
+    // Both tests have started when the run is stopped, then the first
+    // returns early while the second is waiting on the same thread
+    test_suite suite = {
+        .tests   = { &check, &pass },
+        .mode    = run_mode::async,
+        .workers = 1
+    };
+    suite.pre_run = [&](const test_case *test) {
+        if (test == &pass) suite.stop.request_stop();
+    };
+    (void)suite.run();
+
+    CT_ASSERT_END(suite.results.size(), 2uz, "Results");
+    CT_ASSERT(suite.results[0].cancelled, true, "Returned early");
+    CT_ASSERT(suite.results[1].cancelled, false, "Completed");
+
+    CT_END;
+}
+
+/**
+ *  @brief  Test that fails 10 assertions on each of 4 threads, run by
+ *          @c test_concurrent_errors .
+ */
+static CT_TESTER_FN(inner_concurrent)
+{
+    CT_BEGIN_CONCURRENT;
+    {
+        std::vector<std::jthread> threads = {};
+        for (int thread = 0; thread < 4; thread++)
+        {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 100; i++)
+                {
+                    CT_ASSERT(i % 10 == 0, false, "Inner concurrent test");
+                }
+            });
+        }
+    }
+    CT_END;
+}
+
+/**
+ *  @brief  Test with a stress test that fails on one of 4 threads, run by
+ *          @c test_concurrent_errors .
+ */
+static CT_TESTER_FN(inner_stress)
+{
+    CT_BEGIN;
+    CT_ASSERT_STRESS("Inner stress test",
+        [](std::size_t thread) { return thread != 2; },
+        { .threads = 4, .iterations = 100 });
+    CT_END;
+}
+
+CT_TEST(test_concurrent_errors, "Errors are counted from any thread and "
+    "stress failures per thread") {
+    CT_BEGIN;
+
+    CT_ASSERT(inner_concurrent(), 40uz, "Errors of the threads");
+
+    auto failing = run_stress([](std::size_t thread) { return thread != 2; },
+        { .threads = 4, .iterations = 100 });
+    CT_ASSERT((failing.failures == std::vector<std::size_t> { 0, 0, 100, 0 }),
+        true, "Failures of each thread");
+    CT_ASSERT((failing.operations == std::vector<std::size_t>(4, 100)),
+        true, "Operations of each thread");
+    CT_ASSERT(failing.total_failures(), 100uz, "Total failures");
+
+    auto throwing = run_stress([](std::size_t thread) {
+        if (thread == 1) throw std::runtime_error("Inner stress body");
+    }, { .threads = 2, .iterations = 10 });
+    CT_ASSERT((throwing.failures == std::vector<std::size_t> { 0, 10 }),
+        true, "Failures of a throwing thread");
+
+    CT_ASSERT(inner_stress(), 100uz, "Errors of CT_ASSERT_STRESS");
+
+    CT_END;
+}
+
+CT_TEST(test_file_lines_chunks, "Lines of a file split into chunks") {
+    CT_BEGIN;
+
+    auto path = (std::filesystem::temp_directory_path()
+        / "confer_tester_lines.txt").string();
+
+    // Empty lines, "\r\n" endings, and with and without a last line ending
+    std::vector<std::pair<std::string, std::vector<std::string>>> files = {
+        { "alpha\nbe\r\n\n\ngamma delta\r\nx\nlast",
+          { "alpha", "be", "", "", "gamma delta", "x", "last" } },
+        { "a\n\nb\r\n", { "a", "", "b" } },
+        { "\n", { "" } }
+    };
+
+    for (auto &[text, expected] : files)
+    {
+        std::ofstream(path, std::ios::binary) << text;
+        mapped_file file(path);
+
+        // Every chunk size puts the chunk boundaries everywhere in the lines
+        for (std::size_t chunk_size = 1; chunk_size <= text.size() + 1;
+             chunk_size++)
+        {
+            file_lines               lines = { &file, chunk_size };
+            std::vector<std::string> found = {};
+            std::size_t              count = 0;
+            for (std::size_t chunk = 0; chunk < lines.chunk_count(); chunk++)
+            {
+                count += lines.for_each_row(chunk, [&](std::string_view line) {
+                    found.emplace_back(line);
+                    return true;
+                });
+            }
+            CT_ASSERT(count, expected.size(), "Number of lines");
+            CT_ASSERT((found == expected), true, "Lines");
+        }
+    }
+
+    std::filesystem::remove(path);
+    CT_END;
+}
+
+CT_TEST(test_snapshots, "Snapshots are created, matched and updated") {
+    CT_BEGIN;
+
+    auto directory = std::filesystem::temp_directory_path()
+        / "confer_tester_snapshots";
+    auto path = (directory / "nested" / "value.bin").string();
+    std::filesystem::remove_all(directory);
+
+    // Larger than a chunk compared at once
+    std::vector<std::uint32_t> value(100000);
+    for (std::size_t i = 0; i < value.size(); i++) value[i] = (std::uint32_t)i;
+
+    update_snapshots = false;
+    auto missing = check_snapshot(snapshot_bytes(value), path);
+    CT_ASSERT(missing.passed, false, "Missing snapshot");
+    CT_ASSERT(std::filesystem::exists(path), false, "Not created");
+
+    update_snapshots = true;
+    auto created = check_snapshot(snapshot_bytes(value), path);
+    CT_ASSERT(created.passed && created.updated, true, "Created snapshot");
+
+    update_snapshots = false;
+    auto matched = check_snapshot(snapshot_bytes(value), path);
+    CT_ASSERT(matched.passed && !matched.updated, true, "Matched snapshot");
+    CT_ASSERT(matched.first_difference.has_value(), false, "No difference");
+
+    auto changed = value;
+    changed[70000] = 0;
+    auto mismatched = check_snapshot(snapshot_bytes(changed), path);
+    CT_ASSERT(mismatched.passed, false, "Mismatched snapshot");
+    CT_ASSERT(mismatched.first_difference.value_or(0),
+        70000 * sizeof(std::uint32_t), "First difference");
+
+    // A prefix differs at its end
+    auto prefix  = std::span(value).first(1000);
+    auto shorter = check_snapshot(snapshot_bytes(prefix), path);
+    CT_ASSERT(shorter.passed, false, "Prefix of the snapshot");
+    CT_ASSERT(shorter.first_difference.value_or(0), std::size(prefix)
+        * sizeof(std::uint32_t), "Difference at the end of the prefix");
+
+    update_snapshots = true;
+    auto updated = check_snapshot(snapshot_bytes(changed), path);
+    CT_ASSERT(updated.passed && updated.updated, true, "Updated snapshot");
+    auto unchanged = check_snapshot(snapshot_bytes(changed), path);
+    CT_ASSERT(unchanged.passed && !unchanged.updated, true,
+        "Equal snapshot left alone");
+
+    update_snapshots = false;
+    CT_ASSERT(check_snapshot(snapshot_bytes(changed), path).passed, true,
+        "Matched updated snapshot");
+    CT_ASSERT(check_snapshot(snapshot_bytes(value), path).passed, false,
+        "Old value mismatched");
+
+    std::filesystem::remove_all(directory);
+    CT_END;
+}
+
 /**
  *  @brief   Yes, a literal test the tester.
  *  @return  Zero on success.
  */
 auto main() -> int try
 {
-    ///  @todo  Test the tester... if there is anything to test that is...
+    test_suite suite = {
+        .tests    = registered_tests().tests(),
+        .pre_run  = default_pre_runner('=',  3),
+        .post_run = default_post_runner('=', 3)
+    };
+
+    auto failed_tests = suite.run();
+    print_failed_tests(failed_tests);
+    return sum_failed_tests_errors(failed_tests) != 0;
 }
 catch (const std::exception &e)
-{}
+{
+    std::println("Exception: {}", e.what());
+    return 1;
+}
 catch (...)
-{}
+{
+    std::println("Unknown exception");
+    return 1;
+}